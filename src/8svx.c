@@ -8,6 +8,7 @@
 #include <stdio.h>
 
 #define BUFLEN 512
+#define SVXHEADERSIZE 100
 
 /* Private data used by writer */
 typedef struct{
@@ -15,7 +16,9 @@ typedef struct{
   uint32_t left;
   off_t ch0_pos;
   sox_uint8_t buf[4][BUFLEN];
-  FILE* tmp[4];
+  sox_bool streaming;     /* Header written; channel 0 goes straight out */
+  sox_uint8_t * chan[4];  /* Channels held until stopwrite */
+  size_t frames, frames_size;
 } priv_t;
 
 static void svxwriteheader(sox_format_t *, size_t);
@@ -209,21 +212,21 @@ static size_t read_samples(sox_format_t * ft, sox_sample_t *buf, size_t nsamp)
 /*======================================================================*/
 /*                         8SVXSTARTWRITE                               */
 /*======================================================================*/
+/* The BODY holds each channel in turn, so all but the first channel must
+ * be held back until the end.  If the length is known in advance, the
+ * header is written now and the first channel is written as it arrives;
+ * otherwise everything is held and written out in stopwrite. */
 static int startwrite(sox_format_t * ft)
 {
         priv_t * p = (priv_t * ) ft->priv;
-        size_t i;
-
-        /* open channel output files */
-        for (i = 0; i < ft->signal.channels; i++) {
-                if ((p->tmp[i] = lsx_tmpfile()) == NULL)
-                {
-                        lsx_fail_errno(ft,errno,"Can't open channel output file");
-                        return(SOX_EOF);
-                }
-        }
 
         p->nsamples = 0;
+        p->frames = p->frames_size = 0;
+        p->streaming = ft->signal.length &&
+            ft->signal.length <= UINT32_MAX - SVXHEADERSIZE &&
+            ft->signal.length % ft->signal.channels == 0;
+        if (p->streaming)
+                svxwriteheader(ft, (size_t) ft->signal.length);
         return(SOX_SUCCESS);
 }
 
@@ -236,19 +239,34 @@ static size_t write_samples(sox_format_t * ft, const sox_sample_t *buf, size_t l
         priv_t * p = (priv_t * ) ft->priv;
         SOX_SAMPLE_LOCALS;
 
-        unsigned char datum;
-        size_t done = 0, i;
-
-        p->nsamples += len;
+        unsigned channels = ft->signal.channels, first = p->streaming, ch;
+        size_t frames = len / channels, done = 0, i, chunk;
 
-        while(done < len) {
-                for (i = 0; i < ft->signal.channels; i++) {
-                        datum = SOX_SAMPLE_TO_SIGNED_8BIT(*buf++, ft->clips);
-                        putc(datum, p->tmp[i]);
+        if (p->frames + frames > p->frames_size) {
+                p->frames_size = max(p->frames_size * 2, p->frames + frames);
+                for (ch = first; ch < channels; ch++)
+                        p->chan[ch] = lsx_realloc(p->chan[ch], p->frames_size);
+        }
+        for (ch = first; ch < channels; ch++)
+                for (i = 0; i < frames; i++)
+                        p->chan[ch][p->frames + i] =
+                            SOX_SAMPLE_TO_SIGNED_8BIT(buf[i * channels + ch], ft->clips);
+
+        if (first) {
+                for (; done < frames; done += chunk) {
+                        chunk = min(frames - done, BUFLEN);
+                        for (i = 0; i < chunk; i++)
+                                p->buf[0][i] = SOX_SAMPLE_TO_SIGNED_8BIT(
+                                    buf[(done + i) * channels], ft->clips);
+                        if (lsx_writebuf(ft, p->buf[0], chunk) != chunk)
+                                break;
                 }
-                done += ft->signal.channels;
+                frames = done;
         }
-        return (done);
+
+        p->frames += frames;
+        p->nsamples += frames * channels;
+        return frames * channels;
 }
 
 /*======================================================================*/
@@ -258,41 +276,43 @@ static size_t write_samples(sox_format_t * ft, const sox_sample_t *buf, size_t l
 static int stopwrite(sox_format_t * ft)
 {
         priv_t * p = (priv_t * ) ft->priv;
+        int rc = SOX_SUCCESS;
+        size_t i;
 
-        size_t i, len;
-        char svxbuf[512];
-
-        svxwriteheader(ft, (size_t) p->nsamples);
+        if (!p->streaming)
+                svxwriteheader(ft, (size_t) p->nsamples);
 
-        /* append all channel pieces to channel 0 */
-        /* close temp files */
-        for (i = 0; i < ft->signal.channels; i++) {
-                if (fseeko(p->tmp[i], (off_t)0, 0))
-                {
-                        lsx_fail_errno (ft,errno,"Can't rewind channel output file %lu",(unsigned long)i);
-                        return(SOX_EOF);
+        /* append the held channels to channel 0 */
+        for (i = p->streaming; i < ft->signal.channels; i++) {
+                if (rc == SOX_SUCCESS &&
+                    lsx_writebuf(ft, p->chan[i], p->frames) != p->frames) {
+                        lsx_fail_errno (ft,errno,"Can't write channel output file %lu",(unsigned long)i);
+                        rc = SOX_EOF;
                 }
-                while (!feof(p->tmp[i])) {
-                        len = fread(svxbuf, (size_t) 1, (size_t) 512, p->tmp[i]);
-                        if (lsx_writebuf(ft, svxbuf, len) != len) {
-                          lsx_fail_errno (ft,errno,"Can't write channel output file %lu",(unsigned long)i);
-                          return SOX_EOF;
-                        }
-                }
-                fclose (p->tmp[i]);
+                free(p->chan[i]);
         }
+        if (rc != SOX_SUCCESS)
+                return rc;
 
         /* add a pad byte if BODY size is odd */
         if(p->nsamples % 2 != 0)
             lsx_writeb(ft, '\0');
 
+        /* Fix up the header if the length given in advance was wrong */
+        if (p->streaming && p->nsamples != ft->signal.length) {
+                if (!ft->seekable || lsx_seeki(ft, (off_t)0, SEEK_SET) != 0) {
+                        lsx_fail_errno(ft,SOX_EOF,"can't rewind output file to rewrite 8SVX header");
+                        return(SOX_EOF);
+                }
+                svxwriteheader(ft, (size_t) p->nsamples);
+        }
+
         return(SOX_SUCCESS);
 }
 
 /*======================================================================*/
 /*                         8SVXWRITEHEADER                              */
 /*======================================================================*/
-#define SVXHEADERSIZE 100
 static void svxwriteheader(sox_format_t * ft, size_t nsamples)
 {
         size_t formsize =  nsamples + SVXHEADERSIZE - 8;
@@ -57,6 +57,9 @@ sox_sample_t stepAdjustTable[] = {
         768, 614, 512, 409, 307, 230, 230, 230
 };
 
+/* samples used by lsx_ms_adpcm_block_prime_i() to settle the step size */
+#define MS_PRIME_SAMPLES 64
+
 /* TODO : The first 7 lsx_ms_adpcm_i_coef sets are always hardcoded and must
    appear in the actual WAVE file.  They should be read in
    in case a sound program added extras to the list. */
@@ -250,40 +253,95 @@ static int AdpcmMashS(
         return (int) sqrt(d2);
 }
 
+#define MS_COEF_SETS 7 /* the standard coef sets */
+
+/*
+ * AdpcmSelectCoefs - choose which of the 7 standard coef sets are worth
+ * trial-encoding at the given effort: effort + 1 of them, ranked by their
+ * open-loop prediction error on the input, so all of them from effort 6 up.
+ * Returns the number of sets chosen, stored in ascending order in set[].
+ */
+static int AdpcmSelectCoefs(
+        unsigned ch,             /* channel number to encode, REQUIRE 0 <= ch < chans  */
+        unsigned chans,          /* total channels */
+        const SAMPL *ip,    /* ip[] is interleaved input samples */
+        int n,              /* samples to encode PER channel */
+        int effort,         /* REQUIRE 0 <= effort */
+        int *set            /* output set[MS_COEF_SETS] */
+)
+{
+        double e[MS_COEF_SETS];
+        int chosen[MS_COEF_SETS];
+        int i, k, nk = min(effort + 1, MS_COEF_SETS);
+
+        for (k = 0; k < MS_COEF_SETS; k++)
+                e[k] = 0, chosen[k] = nk == MS_COEF_SETS;
+
+        if (nk < MS_COEF_SETS) {
+                ip += ch;
+                for (i = 2; i < n; i++) {
+                        int x = ip[i*chans], x1 = ip[(i-1)*chans], x2 = ip[(i-2)*chans];
+                        for (k = 0; k < MS_COEF_SETS; k++) {
+                                int d = x - ((x1 * lsx_ms_adpcm_i_coef[k][0] +
+                                              x2 * lsx_ms_adpcm_i_coef[k][1]) >> 8);
+                                e[k] += (double)d * d;
+                        }
+                }
+                for (i = 0; i < nk; i++) {
+                        int best = -1;
+                        for (k = 0; k < MS_COEF_SETS; k++)
+                                if (!chosen[k] && (best < 0 || e[k] < e[best]))
+                                        best = k;
+                        chosen[best] = 1;
+                }
+        }
+
+        for (i = k = 0; k < MS_COEF_SETS; k++)
+                if (chosen[k])
+                        set[i++] = k;
+        return nk;
+}
+
 static inline void AdpcmMashChannel(
         unsigned ch,             /* channel number to encode, REQUIRE 0 <= ch < chans  */
         unsigned chans,          /* total channels */
         const SAMPL *ip,    /* ip[] is interleaved input samples */
         int n,              /* samples to encode PER channel, REQUIRE */
         int *st,            /* input/output steps, 16<=st[i] */
-        unsigned char *obuff /* output buffer[blockAlign] */
+        unsigned char *obuff, /* output buffer[blockAlign] */
+        int effort          /* REQUIRE 0 <= effort */
 )
 {
         SAMPL v[2];
+        int set[MS_COEF_SETS];
         int n0,s0,s1,ss,smin;
-        int dmin,k,kmin;
+        int dmin,i,k,kmin,nk;
 
         n0 = n/2; if (n0>32) n0=32;
         if (*st<16) *st = 16;
         v[1] = ip[ch];
         v[0] = ip[ch+chans];
 
+        nk = AdpcmSelectCoefs(ch, chans, ip, n, effort, set);
         dmin = 0; kmin = 0; smin = 0;
-        /* for each of 7 standard coeff sets, we try compression
-         * beginning with last step-value, and with slightly
-         * forward-adjusted step-value, taking best of the 14
+        /* for each chosen coeff set, we try compression
+         * beginning with last step-value, and (unless at the lowest effort)
+         * with slightly forward-adjusted step-value, taking the best
          */
-        for (k=0; k<7; k++) {
+        for (i=0; i<nk; i++) {
                 int d0,d1;
+                k = set[i];
                 ss = s0 = *st;
                 d0=AdpcmMashS(ch, chans, v, lsx_ms_adpcm_i_coef[k], ip, n, &ss, NULL); /* with step s0 */
 
-                s1 = s0;
-                AdpcmMashS(ch, chans, v, lsx_ms_adpcm_i_coef[k], ip, n0, &s1, NULL);
-                lsx_debug_more(" s32 %d\n",s1);
-                ss = s1 = (3*s0+s1)/4;
-                d1=AdpcmMashS(ch, chans, v, lsx_ms_adpcm_i_coef[k], ip, n, &ss, NULL); /* with step s1 */
-                if (!k || d0<dmin || d1<dmin) {
+                d1 = d0; s1 = s0;
+                if (effort > 0) {
+                        AdpcmMashS(ch, chans, v, lsx_ms_adpcm_i_coef[k], ip, n0, &s1, NULL);
+                        lsx_debug_more(" s32 %d\n",s1);
+                        ss = s1 = (3*s0+s1)/4;
+                        d1=AdpcmMashS(ch, chans, v, lsx_ms_adpcm_i_coef[k], ip, n, &ss, NULL); /* with step s1 */
+                }
+                if (!i || d0<dmin || d1<dmin) {
                         kmin = k;
                         if (d0<=d1) {
                                 dmin = d0;
@@ -306,7 +364,8 @@ void lsx_ms_adpcm_block_mash_i(
         int n,              /* samples to encode PER channel */
         int *st,            /* input/output steps, 16<=st[i] */
         unsigned char *obuff,      /* output buffer[blockAlign]     */
-        int blockAlign      /* >= 7*chans + chans*(n-2)/2.0    */
+        int blockAlign,     /* >= 7*chans + chans*(n-2)/2.0    */
+        int effort          /* 0 (fastest) up; the same from 6 (best) */
 )
 {
         unsigned ch;
@@ -318,7 +377,30 @@ void lsx_ms_adpcm_block_mash_i(
         for (p=obuff+7*chans; p<obuff+blockAlign; p++) *p=0;
 
         for (ch=0; ch<chans; ch++)
-                AdpcmMashChannel(ch, chans, ip, n, st+ch, obuff);
+                AdpcmMashChannel(ch, chans, ip, n, st+ch, obuff, effort);
+}
+
+/* estimate the steps lsx_ms_adpcm_block_mash_i() leaves after encoding
+ * ip[], without depending on the steps it started from, so that the
+ * following block can be encoded independently of this one */
+void lsx_ms_adpcm_block_prime_i(
+        unsigned chans,          /* total channels */
+        const SAMPL *ip,    /* ip[n*chans] is interleaved input samples */
+        int n,              /* samples PER channel in ip[], REQUIRE n >= 2 */
+        int *st             /* output steps[chans] */
+)
+{
+        unsigned ch;
+        int m = n < MS_PRIME_SAMPLES? n : MS_PRIME_SAMPLES;
+
+        ip += (n - m) * chans; /* the step size settles within a few samples */
+        for (ch=0; ch<chans; ch++) {
+                SAMPL v[2];
+                v[1] = ip[ch];
+                v[0] = ip[ch+chans];
+                st[ch] = 16;
+                AdpcmMashS(ch, chans, v, lsx_ms_adpcm_i_coef[0], ip, m, st+ch, NULL);
+        }
 }
 
 /*
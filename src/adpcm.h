@@ -48,7 +48,19 @@ extern void lsx_ms_adpcm_block_mash_i(
 	int n,              /* samples to encode PER channel, REQUIRE */
 	int *st,            /* input/output steps, 16<=st[i] */
 	unsigned char *obuff,      /* output buffer[blockAlign] */
-	int blockAlign      /* >= 7*chans + n/2          */
+	int blockAlign,     /* >= 7*chans + n/2          */
+	int effort          /* 0 (fastest) up: trial-encodes the effort + 1 most
+	                       promising of the 7 standard coef sets, so all of
+	                       them from 6; at 0, with one step-value, not 2 */
+);
+
+/* estimate the output steps of lsx_ms_adpcm_block_mash_i() for ip[] without
+ * depending on its input steps, so blocks can be mashed independently */
+extern void lsx_ms_adpcm_block_prime_i(
+	unsigned chans,          /* total channels */
+	const SAMPL *ip,    /* ip[n*chans] is interleaved input samples */
+	int n,              /* samples PER channel in ip[], REQUIRE n >= 2 */
+	int *st             /* output steps[chans] */
 );
 
 /* Some helper functions for computing samples/block and blockalign */
@@ -228,6 +228,32 @@ int lsx_adpcm_stopread(sox_format_t * ft UNUSED, adpcm_io_t * state)
   return (SOX_SUCCESS);
 }
 
+/******************************************************************************
+ * Function   : lsx_adpcm_seek
+ * Description: Moves to a sample offset and restarts the decoder there.
+ * Parameters : ft     - file info structure
+ *              state  - ADPCM state structure
+ *              offset - sample offset from the start of the data
+ * Returns    : int    - SOX_SUCCESS
+ *                       SOX_EOF
+ * Exceptions :
+ * Notes      : 1. Bytes buffered and codec state from before the seek are
+ *                 dropped, so the result doesn't depend on where the
+ *                 previous read stopped.
+ ******************************************************************************/
+
+int lsx_adpcm_seek(sox_format_t * ft, adpcm_io_t * state, uint64_t offset)
+{
+  int errors = state->encoder.errors;
+  int result = lsx_rawseek(ft, offset);
+
+  if (result == SOX_SUCCESS) {
+    lsx_adpcm_reset(state, ft->encoding.encoding);
+    state->encoder.errors = errors;
+  }
+  return result;
+}
+
 
 /******************************************************************************
  * Function   : write
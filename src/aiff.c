@@ -596,7 +596,9 @@ int lsx_aiffstopread(sox_format_t * ft)
 
 /* When writing, the header is supposed to contain the number of
    samples and data bytes written.
-   Since we don't know how many samples there are until we're done,
+   If the length is known in advance, the header is written with it
+   and is not rewritten unless the guess turns out wrong.  Otherwise,
+   since we don't know how many samples there are until we're done,
    we first write the header with an very large number,
    and at the end we rewind the file and write the header again
    with the right number.  This only works if the file is seekable;
@@ -613,6 +615,9 @@ int lsx_aiffstartwrite(sox_format_t * ft)
         if (rc)
             return rc;
 
+        if (ft->signal.length)
+            return(aiffwriteheader(ft, ft->signal.length / ft->signal.channels));
+
         /* Compute the "very large number" so that a maximum number
            of samples can be transmitted through a pipe without the
            risk of causing overflow when calculating the number of bytes.
@@ -632,6 +637,10 @@ int lsx_aiffstopwrite(sox_format_t * ft)
             lsx_rawwrite(ft, &buf, (size_t) 1);
         }
 
+        /* The header written by startwrite is right if the length was
+           known then; there is no need to seek back */
+        if (ft->signal.length && ft->olength == ft->signal.length)
+            return(SOX_SUCCESS);
         if (!ft->seekable)
         {
             lsx_fail_errno(ft,SOX_EOF,"Non-seekable file.");
@@ -810,6 +819,9 @@ int lsx_aifcstartwrite(sox_format_t * ft)
         if (rc)
             return rc;
 
+        if (ft->signal.length)
+            return(aifcwriteheader(ft, ft->signal.length / ft->signal.channels));
+
         /* Compute the "very large number" so that a maximum number
            of samples can be transmitted through a pipe without the
            risk of causing overflow when calculating the number of bytes.
@@ -829,6 +841,10 @@ int lsx_aifcstopwrite(sox_format_t * ft)
             lsx_rawwrite(ft, &buf, (size_t) 1);
         }
 
+        /* The header written by startwrite is right if the length was
+           known then; there is no need to seek back */
+        if (ft->signal.length && ft->olength == ft->signal.length)
+            return(SOX_SUCCESS);
         if (!ft->seekable)
         {
             lsx_fail_errno(ft,SOX_EOF,"Non-seekable file.");
@@ -17,12 +17,14 @@
 
 #include "sox_i.h"
 #include <alsa/asoundlib.h>
+#include <time.h>
 
 typedef struct {
-  snd_pcm_uframes_t  buf_len, period;
+  snd_pcm_uframes_t  buf_len, period, frames;
   snd_pcm_t          * pcm;
-  char               * buf;
+  char               * buf;          /* Not used with mmap access */
   unsigned int       format;
+  sox_bool           mmap;
 } priv_t;
 
 static const
@@ -115,7 +117,10 @@ static int setup(sox_format_t * ft)
 #if SND_LIB_VERSION >= 0x010009               /* Disable alsa-lib resampling: */
   _(snd_pcm_hw_params_set_rate_resample, (p->pcm, params, 0));
 #endif
-  _(snd_pcm_hw_params_set_access, (p->pcm, params, SND_PCM_ACCESS_RW_INTERLEAVED));
+  /* Prefer to convert directly to or from the device's buffer: */
+  p->mmap = snd_pcm_hw_params_test_access(p->pcm, params, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0;
+  _(snd_pcm_hw_params_set_access, (p->pcm, params, p->mmap?
+        SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED));
 
   _(snd_pcm_format_mask_malloc, (&mask));           /* Set format: */
   snd_pcm_hw_params_get_format_mask(params, mask);
@@ -140,10 +145,14 @@ static int setup(sox_format_t * ft)
   /* Set buf_len > > sox_globals.bufsiz for no underrun: */
   p->buf_len = sox_globals.bufsiz * 8 / formats[p->format].bytes /
       ft->signal.channels;
+  if (sox_globals.device_buffer)
+    p->buf_len = sox_globals.device_buffer;
   _(snd_pcm_hw_params_get_buffer_size_min, (params, &min));
   _(snd_pcm_hw_params_get_buffer_size_max, (params, &max));
-  p->period = range_limit(p->buf_len, min, max) / 8;
-  p->buf_len = p->period * 8;
+  p->buf_len = range_limit(p->buf_len, min, max);
+  p->period = sox_globals.device_period? sox_globals.device_period : p->buf_len / 8;
+  if (!sox_globals.device_buffer)
+    p->buf_len = p->period * 8;
   _(snd_pcm_hw_params_set_period_size_near, (p->pcm, params, &p->period, 0));
   _(snd_pcm_hw_params_set_buffer_size_near, (p->pcm, params, &p->buf_len));
   if (p->period * 2 > p->buf_len) {
@@ -154,8 +163,13 @@ static int setup(sox_format_t * ft)
   _(snd_pcm_hw_params, (p->pcm, params));           /* Configure ALSA */
   snd_pcm_hw_params_free(params), params = NULL;
   _(snd_pcm_prepare, (p->pcm));
+  lsx_report("%s access; buffer %lu frames, period %lu frames",
+      p->mmap? "mmap" : "read/write", p->buf_len, p->period);
+  ft->device.buffer_size = p->frames = p->buf_len;
+  ft->device.fill_min = p->frames;
   p->buf_len *= ft->signal.channels;                /* No longer in `frames' */
-  p->buf = lsx_malloc(p->buf_len * formats[p->format].bytes);
+  if (!p->mmap)
+    p->buf = lsx_malloc(p->buf_len * formats[p->format].bytes);
   return SOX_SUCCESS;
 
 error:
@@ -164,10 +178,21 @@ error:
   return SOX_EOF;
 }
 
+static double now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
 static int recover(sox_format_t * ft, snd_pcm_t * pcm, int err)
 {
-  if (err == -EPIPE)
+  double start = now();
+
+  if (err == -EPIPE) {
     lsx_warn("%s-run", ft->mode == 'r'? "over" : "under");
+    ++ft->device.xruns;
+  }
   else if (err != -ESTRPIPE)
     lsx_warn("%s", snd_strerror(err));
   else while ((err = snd_pcm_resume(pcm)) == -EAGAIN) {
@@ -176,85 +201,228 @@ static int recover(sox_format_t * ft, snd_pcm_t * pcm, int err)
   }
   if (err < 0 && (err = snd_pcm_prepare(pcm)) < 0)
     lsx_fail_errno(ft, SOX_EPERM, "%s", snd_strerror(err));
+  ft->device.xrun_time += now() - start;
   return err;
 }
 
+/* Records the device buffer fill after a transfer; avail is as returned by
+ * snd_pcm_avail_update, i.e. frames to read, or room to write. */
+static void update_fill(sox_format_t * ft, snd_pcm_uframes_t avail)
+{
+  priv_t * p = (priv_t *)ft->priv;
+  sox_device_stats_t * d = &ft->device;
+
+  d->fill = ft->mode == 'r'? avail : p->frames - min(avail, p->frames);
+  d->fill_min = min(d->fill_min, d->fill);
+  d->fill_max = max(d->fill_max, d->fill);
+}
+
+static void decode(sox_format_t * ft, sox_sample_t * buf, void const * data, size_t i)
+{
+  priv_t * p = (priv_t *)ft->priv;
+
+  switch (formats[p->format].alsa_fmt) {
+    case SND_PCM_FORMAT_S8: {
+      int8_t const * buf1 = (int8_t const *)data;
+      while (i--) *buf++ = SOX_SIGNED_8BIT_TO_SAMPLE(*buf1++,);
+      break;
+    }
+    case SND_PCM_FORMAT_U8: {
+      uint8_t const * buf1 = (uint8_t const *)data;
+      while (i--) *buf++ = SOX_UNSIGNED_8BIT_TO_SAMPLE(*buf1++,);
+      break;
+    }
+    case SND_PCM_FORMAT_S16: {
+      int16_t const * buf1 = (int16_t const *)data;
+      if (ft->encoding.reverse_bytes) while (i--)
+        *buf++ = SOX_SIGNED_16BIT_TO_SAMPLE(lsx_swapw(*buf1++),);
+      else
+        while (i--) *buf++ = SOX_SIGNED_16BIT_TO_SAMPLE(*buf1++,);
+      break;
+    }
+    case SND_PCM_FORMAT_U16: {
+      uint16_t const * buf1 = (uint16_t const *)data;
+      if (ft->encoding.reverse_bytes) while (i--)
+        *buf++ = SOX_UNSIGNED_16BIT_TO_SAMPLE(lsx_swapw(*buf1++),);
+      else
+        while (i--) *buf++ = SOX_UNSIGNED_16BIT_TO_SAMPLE(*buf1++,);
+      break;
+    }
+    case SND_PCM_FORMAT_S24: {
+      sox_int24_t const * buf1 = (sox_int24_t const *)data;
+      while (i--) *buf++ = SOX_SIGNED_24BIT_TO_SAMPLE(*buf1++,);
+      break;
+    }
+    case SND_PCM_FORMAT_S24_3LE: {
+      unsigned char const * buf1 = (unsigned char const *)data;
+      while (i--) {
+        uint32_t temp;
+        temp  = *buf1++;
+        temp |= *buf1++ << 8;
+        temp |= *buf1++ << 16;
+        *buf++ = SOX_SIGNED_24BIT_TO_SAMPLE((sox_int24_t)temp,);
+      }
+      break;
+    }
+    case SND_PCM_FORMAT_U24: {
+      sox_uint24_t const * buf1 = (sox_uint24_t const *)data;
+      while (i--) *buf++ = SOX_UNSIGNED_24BIT_TO_SAMPLE(*buf1++,);
+      break;
+    }
+    case SND_PCM_FORMAT_S32: {
+      int32_t const * buf1 = (int32_t const *)data;
+      while (i--) *buf++ = SOX_SIGNED_32BIT_TO_SAMPLE(*buf1++,);
+      break;
+    }
+    case SND_PCM_FORMAT_U32: {
+      uint32_t const * buf1 = (uint32_t const *)data;
+      while (i--) *buf++ = SOX_UNSIGNED_32BIT_TO_SAMPLE(*buf1++,);
+      break;
+    }
+    default: break;  /* Can't happen: select_format only picks the above */
+  }
+}
+
+static void encode(sox_format_t * ft, void * data, sox_sample_t const * buf, size_t i)
+{
+  priv_t * p = (priv_t *)ft->priv;
+  SOX_SAMPLE_LOCALS;
+
+  switch (formats[p->format].alsa_fmt) {
+    case SND_PCM_FORMAT_S8: {
+      int8_t * buf1 = (int8_t *)data;
+      while (i--) *buf1++ = SOX_SAMPLE_TO_SIGNED_8BIT(*buf++, ft->clips);
+      break;
+    }
+    case SND_PCM_FORMAT_U8: {
+      uint8_t * buf1 = (uint8_t *)data;
+      while (i--) *buf1++ = SOX_SAMPLE_TO_UNSIGNED_8BIT(*buf++, ft->clips);
+      break;
+    }
+    case SND_PCM_FORMAT_S16: {
+      int16_t * buf1 = (int16_t *)data;
+      if (ft->encoding.reverse_bytes) while (i--)
+        *buf1++ = lsx_swapw(SOX_SAMPLE_TO_SIGNED_16BIT(*buf++, ft->clips));
+      else
+        while (i--) *buf1++ = SOX_SAMPLE_TO_SIGNED_16BIT(*buf++, ft->clips);
+      break;
+    }
+    case SND_PCM_FORMAT_U16: {
+      uint16_t * buf1 = (uint16_t *)data;
+      if (ft->encoding.reverse_bytes) while (i--)
+        *buf1++ = lsx_swapw(SOX_SAMPLE_TO_UNSIGNED_16BIT(*buf++, ft->clips));
+      else
+        while (i--) *buf1++ = SOX_SAMPLE_TO_UNSIGNED_16BIT(*buf++, ft->clips);
+      break;
+    }
+    case SND_PCM_FORMAT_S24: {
+      sox_int24_t * buf1 = (sox_int24_t *)data;
+      while (i--) *buf1++ = SOX_SAMPLE_TO_SIGNED_24BIT(*buf++, ft->clips);
+      break;
+    }
+    case SND_PCM_FORMAT_S24_3LE: {
+      unsigned char *buf1 = (unsigned char *)data;
+      while (i--) {
+        uint32_t temp = (uint32_t)SOX_SAMPLE_TO_SIGNED_24BIT(*buf++, ft->clips);
+        *buf1++ = (temp & 0x000000FF);
+        *buf1++ = (temp & 0x0000FF00) >> 8;
+        *buf1++ = (temp & 0x00FF0000) >> 16;
+      }
+      break;
+    }
+    case SND_PCM_FORMAT_U24: {
+      sox_uint24_t * buf1 = (sox_uint24_t *)data;
+      while (i--) *buf1++ = SOX_SAMPLE_TO_UNSIGNED_24BIT(*buf++, ft->clips);
+      break;
+    }
+    case SND_PCM_FORMAT_S32: {
+      int32_t * buf1 = (int32_t *)data;
+      while (i--) *buf1++ = SOX_SAMPLE_TO_SIGNED_32BIT(*buf++, ft->clips);
+      break;
+    }
+    case SND_PCM_FORMAT_U32: {
+      uint32_t * buf1 = (uint32_t *)data;
+      while (i--) *buf1++ = SOX_SAMPLE_TO_UNSIGNED_32BIT(*buf++, ft->clips);
+      break;
+    }
+    default: break;  /* Can't happen: select_format only picks the above */
+  }
+}
+
+/* mmap access: waits until at least one period (or want frames, if fewer)
+ * can be transferred, starting the device if need be. */
+static snd_pcm_sframes_t wait_avail(sox_format_t * ft, snd_pcm_uframes_t want)
+{
+  priv_t             * p = (priv_t *)ft->priv;
+  snd_pcm_sframes_t  n;
+  int                err;
+
+  while (sox_true) {
+    if ((n = snd_pcm_avail_update(p->pcm)) < 0) {
+      if ((err = recover(ft, p->pcm, (int)n)) < 0)
+        return err;
+      continue;
+    }
+    if ((snd_pcm_uframes_t)n >= min(want, p->period))
+      return n;
+    /* Capture must be started explicitly; playback once the buffer is full: */
+    if (snd_pcm_state(p->pcm) == SND_PCM_STATE_PREPARED)
+      err = snd_pcm_start(p->pcm);
+    else err = snd_pcm_wait(p->pcm, 1000);
+    if (err < 0 && (err = recover(ft, p->pcm, err)) < 0)
+      return err;
+  }
+}
+
+/* mmap access: transfers up to len samples directly between buf and the
+ * device's buffer, returning the number transferred, or < 0 on error. */
+static snd_pcm_sframes_t transfer_mmap(sox_format_t * ft, sox_sample_t * buf, size_t len)
+{
+  priv_t                        * p = (priv_t *)ft->priv;
+  snd_pcm_channel_area_t const  * areas;
+  snd_pcm_uframes_t             offset, frames = len / ft->signal.channels;
+  snd_pcm_sframes_t             avail = wait_avail(ft, frames), n;
+  char                          * data;
+  int                           err;
+
+  if (avail < 0)
+    return avail;
+  frames = min(frames, (snd_pcm_uframes_t)avail);
+  if ((err = snd_pcm_mmap_begin(p->pcm, &areas, &offset, &frames)) < 0)
+    return recover(ft, p->pcm, err) < 0? err : 0;
+  data = (char *)areas[0].addr + (areas[0].first + offset * areas[0].step) / 8;
+  if (ft->mode == 'r')
+    decode(ft, buf, data, frames * ft->signal.channels);
+  else encode(ft, data, buf, frames * ft->signal.channels);
+  n = snd_pcm_mmap_commit(p->pcm, offset, frames);
+  if (n < 0 || (snd_pcm_uframes_t)n != frames)
+    return recover(ft, p->pcm, n < 0? (int)n : -EPIPE) < 0? -1 : 0;
+  update_fill(ft, avail - frames);
+  return n * ft->signal.channels;
+}
+
 static size_t read_(sox_format_t * ft, sox_sample_t * buf, size_t len)
 {
   priv_t             * p = (priv_t *)ft->priv;
-  snd_pcm_sframes_t  i, n;
+  snd_pcm_sframes_t  n;
   size_t             done;
 
   len = min(len, p->buf_len);
   for (done = 0; done < len; done += n) {
+    if (p->mmap) {
+      if ((n = transfer_mmap(ft, buf + done, len - done)) < 0)
+        return 0;
+      continue;
+    }
     do {
       n = snd_pcm_readi(p->pcm, p->buf, (len - done) / ft->signal.channels);
       if (n < 0 && recover(ft, p->pcm, (int)n) < 0)
         return 0;
     } while (n <= 0);
 
-    i = n *= ft->signal.channels;
-    switch (formats[p->format].alsa_fmt) {
-      case SND_PCM_FORMAT_S8: {
-        int8_t * buf1 = (int8_t *)p->buf;
-        while (i--) *buf++ = SOX_SIGNED_8BIT_TO_SAMPLE(*buf1++,);
-        break;
-      }
-      case SND_PCM_FORMAT_U8: {
-        uint8_t * buf1 = (uint8_t *)p->buf;
-        while (i--) *buf++ = SOX_UNSIGNED_8BIT_TO_SAMPLE(*buf1++,);
-        break;
-      }
-      case SND_PCM_FORMAT_S16: {
-        int16_t * buf1 = (int16_t *)p->buf;
-        if (ft->encoding.reverse_bytes) while (i--)
-          *buf++ = SOX_SIGNED_16BIT_TO_SAMPLE(lsx_swapw(*buf1++),);
-        else
-          while (i--) *buf++ = SOX_SIGNED_16BIT_TO_SAMPLE(*buf1++,);
-        break;
-      }
-      case SND_PCM_FORMAT_U16: {
-        uint16_t * buf1 = (uint16_t *)p->buf;
-        if (ft->encoding.reverse_bytes) while (i--)
-          *buf++ = SOX_UNSIGNED_16BIT_TO_SAMPLE(lsx_swapw(*buf1++),);
-        else
-          while (i--) *buf++ = SOX_UNSIGNED_16BIT_TO_SAMPLE(*buf1++,);
-        break;
-      }
-      case SND_PCM_FORMAT_S24: {
-        sox_int24_t * buf1 = (sox_int24_t *)p->buf;
-        while (i--) *buf++ = SOX_SIGNED_24BIT_TO_SAMPLE(*buf1++,);
-        break;
-      }
-      case SND_PCM_FORMAT_S24_3LE: {
-        unsigned char *buf1 = (unsigned char *)p->buf;
-        while (i--) {
-          uint32_t temp;
-          temp  = *buf1++;
-          temp |= *buf1++ << 8;
-          temp |= *buf1++ << 16;
-          *buf++ = SOX_SIGNED_24BIT_TO_SAMPLE((sox_int24_t)temp,);
-        }
-        break;
-      }
-      case SND_PCM_FORMAT_U24: {
-        sox_uint24_t * buf1 = (sox_uint24_t *)p->buf;
-        while (i--) *buf++ = SOX_UNSIGNED_24BIT_TO_SAMPLE(*buf1++,);
-        break;
-      }
-      case SND_PCM_FORMAT_S32: {
-        int32_t * buf1 = (int32_t *)p->buf;
-        while (i--) *buf++ = SOX_SIGNED_32BIT_TO_SAMPLE(*buf1++,);
-        break;
-      }
-      case SND_PCM_FORMAT_U32: {
-        uint32_t * buf1 = (uint32_t *)p->buf;
-        while (i--) *buf++ = SOX_UNSIGNED_32BIT_TO_SAMPLE(*buf1++,);
-        break;
-      }
-      default: lsx_fail_errno(ft, SOX_EFMT, "invalid format");
-        return 0;
-    }
+    n *= ft->signal.channels;
+    decode(ft, buf + done, p->buf, (size_t)n);
+    update_fill(ft, (snd_pcm_uframes_t)max(snd_pcm_avail_update(p->pcm), 0));
   }
   return len;
 }
@@ -264,70 +432,16 @@ static size_t write_(sox_format_t * ft, sox_sample_t const * buf, size_t len)
   priv_t             * p = (priv_t *)ft->priv;
   size_t             done, i, n;
   snd_pcm_sframes_t  actual;
-  SOX_SAMPLE_LOCALS;
 
   for (done = 0; done < len; done += n) {
-    i = n = min(len - done, p->buf_len);
-    switch (formats[p->format].alsa_fmt) {
-      case SND_PCM_FORMAT_S8: {
-        int8_t * buf1 = (int8_t *)p->buf;
-        while (i--) *buf1++ = SOX_SAMPLE_TO_SIGNED_8BIT(*buf++, ft->clips);
-        break;
-      }
-      case SND_PCM_FORMAT_U8: {
-        uint8_t * buf1 = (uint8_t *)p->buf;
-        while (i--) *buf1++ = SOX_SAMPLE_TO_UNSIGNED_8BIT(*buf++, ft->clips);
-        break;
-      }
-      case SND_PCM_FORMAT_S16: {
-        int16_t * buf1 = (int16_t *)p->buf;
-        if (ft->encoding.reverse_bytes) while (i--)
-          *buf1++ = lsx_swapw(SOX_SAMPLE_TO_SIGNED_16BIT(*buf++, ft->clips));
-        else
-          while (i--) *buf1++ = SOX_SAMPLE_TO_SIGNED_16BIT(*buf++, ft->clips);
-        break;
-      }
-      case SND_PCM_FORMAT_U16: {
-        uint16_t * buf1 = (uint16_t *)p->buf;
-        if (ft->encoding.reverse_bytes) while (i--)
-          *buf1++ = lsx_swapw(SOX_SAMPLE_TO_UNSIGNED_16BIT(*buf++, ft->clips));
-        else
-          while (i--) *buf1++ = SOX_SAMPLE_TO_UNSIGNED_16BIT(*buf++, ft->clips);
-        break;
-      }
-      case SND_PCM_FORMAT_S24: {
-        sox_int24_t * buf1 = (sox_int24_t *)p->buf;
-        while (i--) *buf1++ = SOX_SAMPLE_TO_SIGNED_24BIT(*buf++, ft->clips);
-        break;
-      }
-      case SND_PCM_FORMAT_S24_3LE: {
-        unsigned char *buf1 = (unsigned char *)p->buf;
-        while (i--) {
-          uint32_t temp = (uint32_t)SOX_SAMPLE_TO_SIGNED_24BIT(*buf++, ft->clips);
-          *buf1++ = (temp & 0x000000FF);
-          *buf1++ = (temp & 0x0000FF00) >> 8;
-          *buf1++ = (temp & 0x00FF0000) >> 16;
-        }
-        break;
-      }
-      case SND_PCM_FORMAT_U24: {
-        sox_uint24_t * buf1 = (sox_uint24_t *)p->buf;
-        while (i--) *buf1++ = SOX_SAMPLE_TO_UNSIGNED_24BIT(*buf++, ft->clips);
-        break;
-      }
-      case SND_PCM_FORMAT_S32: {
-        int32_t * buf1 = (int32_t *)p->buf;
-        while (i--) *buf1++ = SOX_SAMPLE_TO_SIGNED_32BIT(*buf++, ft->clips);
-        break;
-      }
-      case SND_PCM_FORMAT_U32: {
-        uint32_t * buf1 = (uint32_t *)p->buf;
-        while (i--) *buf1++ = SOX_SAMPLE_TO_UNSIGNED_32BIT(*buf++, ft->clips);
-        break;
-      }
-      default: lsx_fail_errno(ft, SOX_EFMT, "invalid format");
+    if (p->mmap) {
+      if ((actual = transfer_mmap(ft, (sox_sample_t *)buf + done, len - done)) < 0)
         return 0;
+      n = actual;
+      continue;
     }
+    n = min(len - done, p->buf_len);
+    encode(ft, p->buf, buf + done, n);
     for (i = 0; i < n; i += actual * ft->signal.channels) do {
       actual = snd_pcm_writei(p->pcm,
           p->buf + i * formats[p->format].bytes,
@@ -337,6 +451,7 @@ static size_t write_(sox_format_t * ft, sox_sample_t const * buf, size_t len)
       if (actual < 0 && recover(ft, p->pcm, (int)actual) < 0)
         return 0;
     } while (actual < 0);
+    update_fill(ft, (snd_pcm_uframes_t)max(snd_pcm_avail_update(p->pcm), 0));
   }
   return len;
 }
@@ -344,6 +459,13 @@ static size_t write_(sox_format_t * ft, sox_sample_t const * buf, size_t len)
 static int stop(sox_format_t * ft)
 {
   priv_t * p = (priv_t *)ft->priv;
+  sox_device_stats_t const * d = &ft->device;
+
+  if (d->xruns)
+    lsx_report("%" PRIu64 " %s-runs; %g s spent recovering", d->xruns,
+        ft->mode == 'r'? "over" : "under", d->xrun_time);
+  lsx_report("buffer fill %" PRIu64 " to %" PRIu64 " of %" PRIu64 " frames",
+      d->fill_min, d->fill_max, d->buffer_size);
   snd_pcm_close(p->pcm);
   free(p->buf);
   return SOX_SUCCESS;
@@ -358,6 +480,8 @@ static int stop_write(sox_format_t * ft)
   if (npad != n)                      /* pad to hardware period: */
     write_(ft, buf, npad);
   free(buf);
+  if (snd_pcm_state(p->pcm) == SND_PCM_STATE_PREPARED)
+    snd_pcm_start(p->pcm);            /* Not yet started if output was short */
   snd_pcm_drain(p->pcm);
   return stop(ft);
 }
@@ -80,10 +80,12 @@ static sox_encoding_t sox_enc(uint32_t ft_encoding, unsigned * size)
 }
 
 typedef struct {        /* For G72x decoding: */
-  struct g72x_state state;
-  int (*dec_routine)(int i, int out_coding, struct g72x_state *state_ptr);
+  lsx_g72x_batch_t * batch;    /* One lane: the channels share a state */
   unsigned int in_buffer;
   int in_bits;
+  unsigned char * codes;
+  int * pcm;
+  size_t size;
 } priv_t;
 
 /*
@@ -113,15 +115,30 @@ static int unpack_input(sox_format_t * ft, unsigned char *code)
 static size_t dec_read(sox_format_t *ft, sox_sample_t *buf, size_t samp)
 {
   priv_t * p = (priv_t *)ft->priv;
-  unsigned char code;
-  size_t done;
+  size_t done, i;
 
-  for (done = 0; samp > 0 && unpack_input(ft, &code) >= 0; ++done, --samp)
-    *buf++ = SOX_SIGNED_16BIT_TO_SAMPLE(
-        (*p->dec_routine)(code, AUDIO_ENCODING_LINEAR, &p->state),);
+  if (samp > p->size) {
+    p->size = samp;
+    lsx_revalloc(p->codes, p->size);
+    lsx_revalloc(p->pcm, p->size);
+  }
+  for (done = 0; done < samp && unpack_input(ft, p->codes + done) >= 0; ++done);
+  lsx_g72x_batch_decode(p->batch, p->codes, p->pcm, done);
+  for (i = 0; i < done; ++i)
+    buf[i] = SOX_SIGNED_16BIT_TO_SAMPLE(p->pcm[i],);
   return done;
 }
 
+static int stopread(sox_format_t * ft)
+{
+  priv_t * p = (priv_t *)ft->priv;
+
+  lsx_g72x_batch_delete(p->batch);
+  free(p->codes);
+  free(p->pcm);
+  return SOX_SUCCESS;
+}
+
 static int startread(sox_format_t * ft)
 {
   priv_t * p = (priv_t *) ft->priv;
@@ -166,12 +183,11 @@ static int startread(sox_format_t * ft)
   }
 
   switch (ft_encoding) {
-    case Adpcm_g721  : p->dec_routine = g721_decoder   ; break;
-    case Adpcm_g723_3: p->dec_routine = g723_24_decoder; break;
-    case Adpcm_g723_5: p->dec_routine = g723_40_decoder; break;
+    case Adpcm_g721  : p->batch = lsx_g72x_batch_create(&lsx_g721_codec, 1); break;
+    case Adpcm_g723_3: p->batch = lsx_g72x_batch_create(&lsx_g723_24_codec, 1); break;
+    case Adpcm_g723_5: p->batch = lsx_g72x_batch_create(&lsx_g723_40_codec, 1); break;
   }
-  if (p->dec_routine) {
-    g72x_init_state(&p->state);
+  if (p->batch) {
     ft->handler.seek = NULL;
     ft->handler.read = dec_read;
   }
@@ -229,7 +245,7 @@ LSX_FORMAT_HANDLER(au)
   static sox_format_handler_t const handler = {SOX_LIB_VERSION_CODE,
     "PCM file format used widely on Sun systems",
     names, SOX_FILE_BIG_END | SOX_FILE_REWIND,
-    startread, lsx_rawread, NULL,
+    startread, lsx_rawread, stopread,
     write_header, lsx_rawwrite, NULL,
     lsx_rawseek, write_encodings, NULL, sizeof(priv_t)
   };
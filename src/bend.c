@@ -28,14 +28,8 @@
  * ANY KIND. See http://www.dspguru.com/wol.htm for more information.
  */
 
-#ifdef NDEBUG /* Enable assert always. */
-#undef NDEBUG /* Must undef above assert.h or other that might include it. */
-#endif
-
 #include "sox_i.h"
-#include <assert.h>
-
-#define MAX_FRAME_LENGTH 8192
+#include <string.h>
 
 typedef struct {
   unsigned nbends;       /* Number of bends requested */
@@ -52,18 +46,13 @@ typedef struct {
 
   double shift;
 
-  float gInFIFO[MAX_FRAME_LENGTH];
-  float gOutFIFO[MAX_FRAME_LENGTH];
-  double gFFTworksp[2 * MAX_FRAME_LENGTH];
-  float gLastPhase[MAX_FRAME_LENGTH / 2 + 1];
-  float gSumPhase[MAX_FRAME_LENGTH / 2 + 1];
-  float gOutputAccum[2 * MAX_FRAME_LENGTH];
-  float gAnaFreq[MAX_FRAME_LENGTH];
-  float gAnaMagn[MAX_FRAME_LENGTH];
-  float gSynFreq[MAX_FRAME_LENGTH];
-  float gSynMagn[MAX_FRAME_LENGTH];
-  long gRover;
   int fftFrameSize, ovsamp;
+  long gRover;
+  double *window;        /* Hann window, made at start */
+  double *gFFTworksp;
+  float *gInFIFO, *gOutFIFO, *gOutputAccum;
+  float *gLastPhase, *gSumPhase;
+  float *gAnaFreq, *gAnaMagn, *gSynFreq, *gSynMagn;
 } priv_t;
 
 static int parse(sox_effect_t * effp, char **argv, sox_rate_t rate)
@@ -142,45 +131,153 @@ static int start(sox_effect_t * effp)
 
   int n = effp->in_signal.rate / p->frame_rate + .5;
   for (p->fftFrameSize = 2; n > 2; p->fftFrameSize <<= 1, n >>= 1);
-  assert(p->fftFrameSize <= MAX_FRAME_LENGTH);
   p->shift = 1;
   parse(effp, 0, effp->in_signal.rate); /* Re-parse now rate is known */
   p->in_pos = p->bends_pos = 0;
-  for (i = 0; i < p->nbends; ++i)
-    if (p->bends[i].duration)
-      return SOX_SUCCESS;
-  return SOX_EFF_NULL;
+  for (i = 0; i < p->nbends && !p->bends[i].duration; ++i);
+  if (i == p->nbends)
+    return SOX_EFF_NULL;
+
+  n = p->fftFrameSize;
+  p->window = lsx_malloc(n * sizeof(*p->window));
+  for (i = 0; i < (unsigned)n; ++i)
+    p->window[i] = -.5 * cos(2 * M_PI * i / n) + .5;
+  p->gFFTworksp = lsx_calloc(n, sizeof(*p->gFFTworksp));
+  p->gInFIFO = lsx_calloc(n, sizeof(*p->gInFIFO));
+  p->gOutFIFO = lsx_calloc(n, sizeof(*p->gOutFIFO));
+  p->gOutputAccum = lsx_calloc(2 * n, sizeof(*p->gOutputAccum));
+  p->gLastPhase = lsx_calloc(n / 2 + 1, sizeof(*p->gLastPhase));
+  p->gSumPhase = lsx_calloc(n / 2 + 1, sizeof(*p->gSumPhase));
+  p->gAnaFreq = lsx_calloc(n / 2 + 1, sizeof(*p->gAnaFreq));
+  p->gAnaMagn = lsx_calloc(n / 2 + 1, sizeof(*p->gAnaMagn));
+  p->gSynFreq = lsx_calloc(n / 2 + 1, sizeof(*p->gSynFreq));
+  p->gSynMagn = lsx_calloc(n / 2 + 1, sizeof(*p->gSynMagn));
+  p->gRover = 0;
+  return SOX_SUCCESS;
+}
+
+/* Analyses the frame in gInFIFO and adds its pitch-shifted synthesis to
+ * gOutputAccum, using a real FFT: bins 0 and fftFrameSize/2, which are
+ * purely real, are packed by lsx_rdft into gFFTworksp[0] and [1]. */
+static void shift_frame(priv_t * p, double freqPerBin, float pitchShift)
+{
+  double * work = p->gFFTworksp, magn, phase, tmp, real, imag, expct;
+  long k, qpd, index, n = p->fftFrameSize, n2 = n / 2, stepSize = n / p->ovsamp;
+
+  expct = 2. * M_PI * (double) stepSize / (double) n;
+
+  /* do windowing */
+  for (k = 0; k < n; k++)
+    work[k] = p->gInFIFO[k] * p->window[k];
+
+  /* ***************** ANALYSIS ******************* */
+  lsx_safe_rdft(n, 1, work);
+
+  for (k = 0; k <= n2; k++) {
+    /* de-interlace FFT buffer */
+    real = k == n2? work[1] : work[2 * k];
+    imag = k && k < n2? - work[2 * k + 1] : 0;
+
+    /* compute magnitude and phase */
+    magn = 2. * sqrt(real * real + imag * imag);
+    phase = atan2(imag, real);
+
+    /* compute phase difference */
+    tmp = phase - p->gLastPhase[k];
+    p->gLastPhase[k] = phase;
+
+    tmp -= (double) k *expct; /* subtract expected phase difference */
+
+    /* map delta phase into +/- Pi interval */
+    qpd = tmp / M_PI;
+    if (qpd >= 0)
+      qpd += qpd & 1;
+    else qpd -= qpd & 1;
+    tmp -= M_PI * (double) qpd;
+
+    /* get deviation from bin frequency from the +/- Pi interval */
+    tmp = p->ovsamp * tmp / (2. * M_PI);
+
+    /* compute the k-th partials' true frequency */
+    tmp = (double) k *freqPerBin + tmp * freqPerBin;
+
+    /* store magnitude and true frequency in analysis arrays */
+    p->gAnaMagn[k] = magn;
+    p->gAnaFreq[k] = tmp;
+  }
+
+  /* this does the actual pitch shifting */
+  memset(p->gSynMagn, 0, (n2 + 1) * sizeof(*p->gSynMagn));
+  memset(p->gSynFreq, 0, (n2 + 1) * sizeof(*p->gSynFreq));
+  for (k = 0; k <= n2; k++) {
+    index = k * pitchShift;
+    if (index <= n2) {
+      p->gSynMagn[index] += p->gAnaMagn[k];
+      p->gSynFreq[index] = p->gAnaFreq[k] * pitchShift;
+    }
+  }
+
+  for (k = 0; k <= n2; k++) { /* SYNTHESIS */
+    /* get magnitude and true frequency from synthesis arrays */
+    magn = p->gSynMagn[k], tmp = p->gSynFreq[k];
+    tmp -= (double) k *freqPerBin; /* subtract bin mid frequency */
+    tmp /= freqPerBin; /* get bin deviation from freq deviation */
+    tmp = 2. * M_PI * tmp / p->ovsamp; /* take p->ovsamp into account */
+    tmp += (double) k *expct; /* add the overlap phase advance back in */
+    p->gSumPhase[k] += tmp; /* accumulate delta phase to get bin phase */
+    phase = p->gSumPhase[k];
+    /* get real and imag part and re-interleave; the inverse rdft halves
+     * the two real bins, so double them to match */
+    if (k == 0)
+      work[0] = 2 * magn * cos(phase);
+    else if (k == n2)
+      work[1] = 2 * magn * cos(phase);
+    else {
+      work[2 * k] = magn * cos(phase);
+      work[2 * k + 1] = - magn * sin(phase);
+    }
+  }
+
+  lsx_safe_rdft(n, -1, work);
+
+  /* do windowing and add to output accumulator */
+  tmp = 2. / (n2 * p->ovsamp);
+  for (k = 0; k < n; k++)
+    p->gOutputAccum[k] += tmp * p->window[k] * work[k];
+  memcpy(p->gOutFIFO, p->gOutputAccum, stepSize * sizeof(*p->gOutFIFO));
+
+  memmove(p->gOutputAccum, /* shift accumulator */
+      p->gOutputAccum + stepSize, n * sizeof(*p->gOutputAccum));
+
+  memmove(p->gInFIFO, /* move input FIFO */
+      p->gInFIFO + stepSize, (n - stepSize) * sizeof(*p->gInFIFO));
 }
 
 static int flow(sox_effect_t * effp, const sox_sample_t * ibuf,
                 sox_sample_t * obuf, size_t * isamp, size_t * osamp)
 {
   priv_t *p = (priv_t *) effp->priv;
-  size_t i, len = *isamp = *osamp = min(*isamp, *osamp);
-  double magn, phase, tmp, window, real, imag;
-  double freqPerBin, expct;
-  long k, qpd, index, inFifoLatency, stepSize, fftFrameSize2;
+  size_t i, j, n, len = *isamp = *osamp = min(*isamp, *osamp);
+  long inFifoLatency = p->fftFrameSize - p->fftFrameSize / p->ovsamp;
+  double freqPerBin = effp->in_signal.rate / p->fftFrameSize;
   float pitchShift = p->shift;
+  SOX_SAMPLE_LOCALS;
 
-  /* set up some handy variables */
-  fftFrameSize2 = p->fftFrameSize / 2;
-  stepSize = p->fftFrameSize / p->ovsamp;
-  freqPerBin = effp->in_signal.rate / p->fftFrameSize;
-  expct = 2. * M_PI * (double) stepSize / (double) p->fftFrameSize;
-  inFifoLatency = p->fftFrameSize - stepSize;
   if (!p->gRover)
     p->gRover = inFifoLatency;
 
-  /* main processing loop */
-  for (i = 0; i < len; i++) {
-    SOX_SAMPLE_LOCALS;
-    ++p->in_pos;
+  /* main processing loop, up to a frame boundary at a time */
+  for (i = 0; i < len; i += n) {
+    float const * out = p->gOutFIFO + (p->gRover - inFifoLatency);
+    float * in = p->gInFIFO + p->gRover;
 
-    /* As long as we have not yet collected enough data just read in */
-    p->gInFIFO[p->gRover] = SOX_SAMPLE_TO_FLOAT_32BIT(ibuf[i], effp->clips);
-    obuf[i] = SOX_FLOAT_32BIT_TO_SAMPLE(
-        p->gOutFIFO[p->gRover - inFifoLatency], effp->clips);
-    p->gRover++;
+    n = min(len - i, (size_t)(p->fftFrameSize - p->gRover));
+    for (j = 0; j < n; ++j) {
+      in[j] = SOX_SAMPLE_TO_FLOAT_32BIT(ibuf[i + j], effp->clips);
+      obuf[i + j] = SOX_FLOAT_32BIT_TO_SAMPLE(out[j], effp->clips);
+    }
+    p->gRover += n;
+    p->in_pos += n;
 
     /* now we have enough data for processing */
     if (p->gRover >= p->fftFrameSize) {
@@ -198,97 +295,7 @@ static int flow(sox_effect_t * effp, const sox_sample_t * ibuf,
       }
 
       p->gRover = inFifoLatency;
-
-      /* do windowing and re,im interleave */
-      for (k = 0; k < p->fftFrameSize; k++) {
-        window = -.5 * cos(2 * M_PI * k / (double) p->fftFrameSize) + .5;
-        p->gFFTworksp[2 * k] = p->gInFIFO[k] * window;
-        p->gFFTworksp[2 * k + 1] = 0.;
-      }
-
-      /* ***************** ANALYSIS ******************* */
-      lsx_safe_cdft(2 * p->fftFrameSize, 1, p->gFFTworksp);
-
-      /* this is the analysis step */
-      for (k = 0; k <= fftFrameSize2; k++) {
-        /* de-interlace FFT buffer */
-        real = p->gFFTworksp[2 * k];
-        imag = - p->gFFTworksp[2 * k + 1];
-
-        /* compute magnitude and phase */
-        magn = 2. * sqrt(real * real + imag * imag);
-        phase = atan2(imag, real);
-
-        /* compute phase difference */
-        tmp = phase - p->gLastPhase[k];
-        p->gLastPhase[k] = phase;
-
-        tmp -= (double) k *expct; /* subtract expected phase difference */
-
-        /* map delta phase into +/- Pi interval */
-        qpd = tmp / M_PI;
-        if (qpd >= 0)
-          qpd += qpd & 1;
-        else qpd -= qpd & 1;
-        tmp -= M_PI * (double) qpd;
-
-        /* get deviation from bin frequency from the +/- Pi interval */
-        tmp = p->ovsamp * tmp / (2. * M_PI);
-
-        /* compute the k-th partials' true frequency */
-        tmp = (double) k *freqPerBin + tmp * freqPerBin;
-
-        /* store magnitude and true frequency in analysis arrays */
-        p->gAnaMagn[k] = magn;
-        p->gAnaFreq[k] = tmp;
-
-      }
-
-      /* this does the actual pitch shifting */
-      memset(p->gSynMagn, 0, p->fftFrameSize * sizeof(float));
-      memset(p->gSynFreq, 0, p->fftFrameSize * sizeof(float));
-      for (k = 0; k <= fftFrameSize2; k++) {
-        index = k * pitchShift;
-        if (index <= fftFrameSize2) {
-          p->gSynMagn[index] += p->gAnaMagn[k];
-          p->gSynFreq[index] = p->gAnaFreq[k] * pitchShift;
-        }
-      }
-
-      for (k = 0; k <= fftFrameSize2; k++) { /* SYNTHESIS */
-        /* get magnitude and true frequency from synthesis arrays */
-        magn = p->gSynMagn[k], tmp = p->gSynFreq[k];
-        tmp -= (double) k *freqPerBin; /* subtract bin mid frequency */
-        tmp /= freqPerBin; /* get bin deviation from freq deviation */
-        tmp = 2. * M_PI * tmp / p->ovsamp; /* take p->ovsamp into account */
-        tmp += (double) k *expct; /* add the overlap phase advance back in */
-        p->gSumPhase[k] += tmp; /* accumulate delta phase to get bin phase */
-        phase = p->gSumPhase[k];
-        /* get real and imag part and re-interleave */
-        p->gFFTworksp[2 * k] = magn * cos(phase);
-        p->gFFTworksp[2 * k + 1] = - magn * sin(phase);
-      }
-
-      for (k = p->fftFrameSize + 2; k < 2 * p->fftFrameSize; k++)
-        p->gFFTworksp[k] = 0.; /* zero negative frequencies */
-
-      lsx_safe_cdft(2 * p->fftFrameSize, -1, p->gFFTworksp);
-
-      /* do windowing and add to output accumulator */
-      for (k = 0; k < p->fftFrameSize; k++) {
-        window =
-            -.5 * cos(2. * M_PI * (double) k / (double) p->fftFrameSize) + .5;
-        p->gOutputAccum[k] +=
-            2. * window * p->gFFTworksp[2 * k] / (fftFrameSize2 * p->ovsamp);
-      }
-      for (k = 0; k < stepSize; k++)
-        p->gOutFIFO[k] = p->gOutputAccum[k];
-
-      memmove(p->gOutputAccum, /* shift accumulator */
-          p->gOutputAccum + stepSize, p->fftFrameSize * sizeof(float));
-
-      for (k = 0; k < inFifoLatency; k++) /* move input FIFO */
-        p->gInFIFO[k] = p->gInFIFO[k + stepSize];
+      shift_frame(p, freqPerBin, pitchShift);
     }
   }
   return SOX_SUCCESS;
@@ -301,6 +308,17 @@ static int stop(sox_effect_t * effp)
   if (p->bends_pos != p->nbends)
     lsx_warn("Input audio too short; bends not applied: %u",
         p->nbends - p->bends_pos);
+  free(p->gSynMagn);
+  free(p->gSynFreq);
+  free(p->gAnaMagn);
+  free(p->gAnaFreq);
+  free(p->gSumPhase);
+  free(p->gLastPhase);
+  free(p->gOutputAccum);
+  free(p->gOutFIFO);
+  free(p->gInFIFO);
+  free(p->gFFTworksp);
+  free(p->window);
   return SOX_SUCCESS;
 }
 
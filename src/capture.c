@@ -0,0 +1,205 @@
+/* libSoX capture thread     (c) 2014 SoX contributors
+ *
+ * Reads an audio capture device on a thread of its own, into a ring
+ * buffer from which sox_read takes samples, so that a stall in the
+ * effects chain or in writing the output does not overrun the device.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include "sox_i.h"
+#include <string.h>
+
+#if defined HAVE_PTHREAD_H && defined HAVE_STDATOMIC_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+/* The ring has a single writer (the capture thread) and a single reader,
+ * so the two sample counters are all that need be shared.  The mutex and
+ * condition variable are used only when the reader finds the ring empty. */
+struct lsx_capture_t {
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  sox_sample_t * ring, * scratch;
+  size_t size;                  /* Ring size in samples */
+  size_t chunk;                 /* Samples per device read */
+  _Atomic sox_uint64_t head;    /* Samples written to the ring */
+  _Atomic sox_uint64_t tail;    /* Samples read from the ring */
+  _Atomic sox_uint64_t fill_max, dropped;
+  atomic_int waiting, done, stop;
+};
+
+static void wake(lsx_capture_t * c)
+{
+  if (atomic_load(&c->waiting)) {
+    pthread_mutex_lock(&c->mutex);
+    pthread_cond_signal(&c->cond);
+    pthread_mutex_unlock(&c->mutex);
+  }
+}
+
+static void * capture(void * arg)
+{
+  sox_format_t * ft = (sox_format_t *)arg;
+  lsx_capture_t * c = ft->capture;
+  sox_uint64_t head, fill;
+  size_t n, got;
+
+  while (!atomic_load_explicit(&c->stop, memory_order_relaxed)) {
+    head = atomic_load_explicit(&c->head, memory_order_relaxed);
+    fill = head - atomic_load_explicit(&c->tail, memory_order_acquire);
+    if (c->size - fill < c->chunk) {     /* Full, so the chunk is lost */
+      got = (*ft->handler.read)(ft, c->scratch, c->chunk);
+      atomic_fetch_add_explicit(&c->dropped, got, memory_order_relaxed);
+    }
+    else {
+      n = min(c->chunk, c->size - head % c->size);
+      got = (*ft->handler.read)(ft, c->ring + head % c->size, n);
+      atomic_store(&c->head, head + got);
+      if (fill + got > atomic_load_explicit(&c->fill_max, memory_order_relaxed))
+        atomic_store_explicit(&c->fill_max, fill + got, memory_order_relaxed);
+      wake(c);
+    }
+    if (!got)
+      break;
+  }
+  atomic_store(&c->done, 1);
+  wake(c);
+  return NULL;
+}
+
+int lsx_capture_start(sox_format_t * ft)
+{
+  lsx_capture_t * c = lsx_calloc(1, sizeof(*c));
+  unsigned channels = max(ft->signal.channels, 1);
+  pthread_attr_t attr;
+  struct sched_param param;
+  int error;
+
+  c->size = sox_globals.capture_buffer * channels;
+  c->chunk = sox_globals.device_period?
+    sox_globals.device_period * channels : sox_globals.bufsiz;
+  c->chunk = max(min(c->chunk, c->size / 4) / channels, 1) * channels;
+  c->size = max(c->size, c->chunk * 2);
+  c->ring = lsx_malloc(c->size * sizeof(*c->ring));
+  c->scratch = lsx_malloc(c->chunk * sizeof(*c->scratch));
+  pthread_mutex_init(&c->mutex, NULL);
+  pthread_cond_init(&c->cond, NULL);
+  ft->capture = c;
+
+  /* Real-time scheduling is only permitted to suitably privileged users: */
+  pthread_attr_init(&attr);
+  param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+  if (pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED) ||
+      pthread_attr_setschedpolicy(&attr, SCHED_FIFO) ||
+      pthread_attr_setschedparam(&attr, &param) ||
+      pthread_create(&c->thread, &attr, capture, ft)) {
+    lsx_debug("real-time scheduling of the capture thread is not permitted");
+    error = pthread_create(&c->thread, NULL, capture, ft);
+  }
+  else error = 0;
+  pthread_attr_destroy(&attr);
+
+  if (error) {
+    lsx_warn("can't create capture thread: %s", strerror(error));
+    ft->capture = NULL;
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->mutex);
+    free(c->scratch);
+    free(c->ring);
+    free(c);
+    return SOX_EOF;
+  }
+  ft->device.ring_size = c->size / channels;
+  lsx_debug("capture ring %" PRIu64 " frames, read %lu at a time",
+      ft->device.ring_size, (unsigned long)(c->chunk / channels));
+  return SOX_SUCCESS;
+}
+
+size_t lsx_capture_read(sox_format_t * ft, sox_sample_t * buf, size_t len)
+{
+  lsx_capture_t * c = ft->capture;
+  unsigned channels = max(ft->signal.channels, 1);
+  sox_uint64_t tail = atomic_load_explicit(&c->tail, memory_order_relaxed);
+  size_t done = 0, n;
+
+  while (done < len) {
+    sox_uint64_t avail = atomic_load_explicit(&c->head, memory_order_acquire) - tail;
+    if (!avail) {
+      if (atomic_load(&c->done) && atomic_load(&c->head) == tail)
+        break;
+      pthread_mutex_lock(&c->mutex);
+      atomic_store(&c->waiting, 1);
+      while (atomic_load(&c->head) == tail && !atomic_load(&c->done))
+        pthread_cond_wait(&c->cond, &c->mutex);
+      atomic_store(&c->waiting, 0);
+      pthread_mutex_unlock(&c->mutex);
+      continue;
+    }
+    n = min(len - done, c->size - tail % c->size);
+    n = min(n, avail);
+    memcpy(buf + done, c->ring + tail % c->size, n * sizeof(*buf));
+    done += n;
+    tail += n;
+    atomic_store_explicit(&c->tail, tail, memory_order_release);
+  }
+  ft->device.ring_fill = (atomic_load_explicit(&c->head, memory_order_relaxed) - tail) / channels;
+  ft->device.ring_fill_max = atomic_load_explicit(&c->fill_max, memory_order_relaxed) / channels;
+  ft->device.dropped = atomic_load_explicit(&c->dropped, memory_order_relaxed) / channels;
+  return done;
+}
+
+void lsx_capture_stop(sox_format_t * ft)
+{
+  lsx_capture_t * c = ft->capture;
+
+  atomic_store(&c->stop, 1);
+  pthread_join(c->thread, NULL);
+  ft->device.dropped = atomic_load(&c->dropped) / max(ft->signal.channels, 1);
+  if (ft->device.dropped)
+    lsx_warn("%" PRIu64 " frames were dropped because the capture buffer was full",
+        ft->device.dropped);
+  pthread_cond_destroy(&c->cond);
+  pthread_mutex_destroy(&c->mutex);
+  free(c->scratch);
+  free(c->ring);
+  free(c);
+  ft->capture = NULL;
+}
+
+#else
+
+int lsx_capture_start(sox_format_t * ft)
+{
+  (void)ft;
+  lsx_warn("this build of SoX can't read devices on a separate thread");
+  return SOX_EOF;
+}
+
+size_t lsx_capture_read(sox_format_t * ft, sox_sample_t * buf, size_t len)
+{
+  (void)ft, (void)buf, (void)len;
+  return 0;
+}
+
+void lsx_capture_stop(sox_format_t * ft)
+{
+  (void)ft;
+}
+
+#endif
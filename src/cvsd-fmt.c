@@ -26,7 +26,7 @@ LSX_FORMAT_HANDLER(cvsd)
     names, SOX_FILE_MONO,
     lsx_cvsdstartread, lsx_cvsdread, lsx_cvsdstopread,
     lsx_cvsdstartwrite, lsx_cvsdwrite, lsx_cvsdstopwrite,
-    lsx_rawseek, write_encodings, NULL, sizeof(cvsd_priv_t)
+    lsx_cvsdseek, write_encodings, NULL, sizeof(cvsd_priv_t)
   };
   return &handler;
 }
@@ -85,6 +85,20 @@ static size_t cvsdread(sox_format_t * ft, sox_sample_t * buf, size_t len)
   return i;
 }
 
+/* The bit and decoder state restart, as they would on reopening */
+static int seek(sox_format_t * ft, uint64_t offset)
+{
+  priv_t *p = (priv_t *) ft->priv;
+  int result = lsx_rawseek(ft, offset);
+
+  if (result == SOX_SUCCESS) {
+    p->sample = p->step = 0;
+    p->last_n_bits = 5;
+    p->bit_count = 0;
+  }
+  return result;
+}
+
 static size_t cvsdwrite(sox_format_t * ft, sox_sample_t const * buf, size_t len)
 {
   priv_t *p = (priv_t *) ft->priv;
@@ -108,7 +122,7 @@ LSX_FORMAT_HANDLER(cvu)
   static sox_format_handler_t const handler = {SOX_LIB_VERSION_CODE,
     "Headerless Continuously Variable Slope Delta modulation (unfiltered)",
     names, SOX_FILE_MONO, start, cvsdread, NULL, start, cvsdwrite, NULL,
-    lsx_rawseek, write_encodings, NULL, sizeof(priv_t)
+    seek, write_encodings, NULL, sizeof(priv_t)
   };
   return &handler;
 }
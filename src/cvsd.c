@@ -288,18 +288,67 @@ int lsx_cvsdstopread(sox_format_t * ft)
 
 /* ---------------------------------------------------------------------- */
 
+/*
+ * Each byte decodes to 2 * phase_inc samples, not 8, so lsx_rawseek
+ * can't be used.  The decoder restarts as after lsx_cvsdstartread, so
+ * what follows doesn't depend on where the previous read stopped.
+ */
+int lsx_cvsdseek(sox_format_t * ft, uint64_t offset)
+{
+        priv_t *p = (priv_t *) ft->priv;
+        uint64_t per_byte = 2 * p->com.phase_inc;
+        int i;
+
+        if (offset % per_byte)
+                return SOX_EOF;
+        if (lsx_seeki(ft, (off_t)(ft->data_start + offset / per_byte),
+                      SEEK_SET) != SOX_SUCCESS)
+                return SOX_EOF;
+        p->com.overload = 0x5;
+        p->com.mla_int = 0;
+        p->com.phase = 0;
+        p->bit.cnt = 0;
+        for (i = 0; i < CVSD_DEC_FILTERLEN*2; i++)
+                p->c.dec.output_filter[i] = 0;
+        p->c.dec.offset = CVSD_DEC_FILTERLEN - 1;
+        return SOX_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------- */
+
 size_t lsx_cvsdread(sox_format_t * ft, sox_sample_t *buf, size_t nsamp)
 {
         priv_t *p = (priv_t *) ft->priv;
         size_t done = 0;
         float oval;
+        unsigned char in[CVSD_READ_BYTES];
+        size_t in_pos = 0, in_len = 0;
+        /* Each byte yields the same number of samples, so that reading
+         * only the bytes needed for nsamp leaves none unused here. */
+        size_t per_byte = 2 * p->com.phase_inc;
+        unsigned w;
 
         while (done < nsamp) {
                 if (!p->bit.cnt) {
-                        if (lsx_read_b_buf(ft, &(p->bit.shreg), (size_t) 1) != 1)
-                                return done;
+                        if (in_pos == in_len) {
+                                in_len = min(sizeof(in),
+                                    (nsamp - done + per_byte - 1) / per_byte);
+                                in_len = lsx_read_b_buf(ft, in, in_len);
+                                if (!in_len)
+                                        return done;
+                                in_pos = 0;
+                        }
+                        p->bit.shreg = in[in_pos++];
                         p->bit.cnt = 8;
                         p->bit.mask = 1;
+                        /*
+                         * find the slope overload bits of the whole byte:
+                         * bit n is set if bits n-2, n-1 and n are equal
+                         */
+                        w = (p->bit.shreg << 2) | ((p->com.overload & 1) << 1) |
+                            ((p->com.overload >> 1) & 1);
+                        p->bit.overloads = (w & w >> 1 & w >> 2) |
+                            (~w & ~w >> 1 & ~w >> 2);
                 }
                 /*
                  * handle one bit
@@ -307,10 +356,10 @@ size_t lsx_cvsdread(sox_format_t * ft, sox_sample_t *buf, size_t nsamp)
                 p->bit.cnt--;
                 p->com.overload = ((p->com.overload << 1) |
                                    (!!(p->bit.shreg & p->bit.mask))) & 7;
-                p->bit.mask <<= 1;
                 p->com.mla_int *= p->com.mla_tc0;
-                if ((p->com.overload == 0) || (p->com.overload == 7))
+                if (p->bit.overloads & p->bit.mask)
                         p->com.mla_int += p->com.mla_tc1;
+                p->bit.mask <<= 1;
 
                 /* shift output filter window in mirror cirular buffer. */
                 if (p->c.dec.offset != 0)
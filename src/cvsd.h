@@ -23,6 +23,7 @@
 
 #define CVSD_ENC_FILTERLEN 16  /* PCM sampling rate */
 #define CVSD_DEC_FILTERLEN 48  /* CVSD sampling rate */
+#define CVSD_READ_BYTES   256  /* Most bytes read at once when decoding */
 
 typedef struct {
   struct {
@@ -51,6 +52,7 @@ typedef struct {
     unsigned char shreg;
     unsigned mask;
     unsigned cnt;
+    unsigned overloads;   /* decoding: slope overload flags for shreg */
   } bit;
   unsigned bytes_written;
   unsigned cvsd_rate;
@@ -61,6 +63,7 @@ int lsx_cvsdstartwrite(sox_format_t * ft);
 size_t lsx_cvsdread(sox_format_t * ft, sox_sample_t *buf, size_t nsamp);
 size_t lsx_cvsdwrite(sox_format_t * ft, const sox_sample_t *buf, size_t nsamp);
 int lsx_cvsdstopread(sox_format_t * ft);
+int lsx_cvsdseek(sox_format_t * ft, uint64_t offset);
 int lsx_cvsdstopwrite(sox_format_t * ft);
 
 int lsx_dvmsstartread(sox_format_t * ft);
@@ -323,6 +323,7 @@ static int flow_effect(sox_effects_chain_t * chain, size_t n)
   }
 
   effp->oend += obeg;
+  effp->olength += obeg;
 
 #if DEBUG_EFFECTS_CHAIN
   lsx_report("\t" "flow:  %2" PRIuPTR " (%1" PRIuPTR ")  "
@@ -389,6 +390,7 @@ static int drain_effect(sox_effects_chain_t * chain, size_t n)
     effstatus = SOX_EOF;
 
   effp->oend += obeg;
+  effp->olength += obeg;
 
 #if DEBUG_EFFECTS_CHAIN
   lsx_report("\t" "drain: %2" PRIuPTR " (%1" PRIuPTR ")  "
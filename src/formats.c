@@ -619,6 +619,10 @@ static sox_format_t * open_read(
     if (signal->channels && signal->channels != ft->signal.channels)
       lsx_warn("can't set %u channels; using %u", signal->channels, ft->signal.channels);
   }
+
+  if (sox_globals.capture_buffer && (ft->handler.flags & SOX_FILE_DEVICE) &&
+      !(ft->handler.flags & SOX_FILE_PHONY) && ft->handler.read)
+    lsx_capture_start(ft);
   return ft;
 
 error:
@@ -1030,7 +1034,8 @@ size_t sox_read(sox_format_t * ft, sox_sample_t * buf, size_t len)
   size_t actual;
   if (ft->signal.length != SOX_UNSPEC)
     len = min(len, ft->signal.length - ft->olength);
-  actual = ft->handler.read? (*ft->handler.read)(ft, buf, len) : 0;
+  actual = ft->capture? lsx_capture_read(ft, buf, len) :
+    ft->handler.read? (*ft->handler.read)(ft, buf, len) : 0;
   actual = actual > len? 0 : actual;
   ft->olength += actual;
   return actual;
@@ -1043,10 +1048,28 @@ size_t sox_write(sox_format_t * ft, const sox_sample_t *buf, size_t len)
   return actual;
 }
 
+sox_bool sox_can_transcode(sox_format_t const * ift, sox_format_t const * oft)
+{
+  return ift->mode == 'r' && oft->mode == 'w' && lsx_rawcantranscode(ift, oft);
+}
+
+size_t sox_transcode(sox_format_t * ift, sox_format_t * oft, size_t len)
+{
+  size_t actual;
+  if (ift->signal.length != SOX_UNSPEC)
+    len = min(len, ift->signal.length - ift->olength);
+  actual = len? lsx_rawtranscode(ift, oft, len) : 0;
+  ift->olength += actual;
+  oft->olength += actual;
+  return actual;
+}
+
 int sox_close(sox_format_t * ft)
 {
   int result = SOX_SUCCESS;
 
+  if (ft->capture)
+    lsx_capture_stop(ft);
   if (ft->mode == 'r')
     result = ft->handler.stopread? (*ft->handler.stopread)(ft) : SOX_SUCCESS;
   else {
@@ -1088,8 +1111,12 @@ int sox_seek(sox_format_t * ft, sox_uint64_t offset, int whence)
     /* If file is a seekable file and this handler supports seeking,
      * then invoke handler's function.
      */
-    if (ft->seekable && ft->handler.seek)
-      return (*ft->handler.seek)(ft, offset);
+    if (ft->seekable && ft->handler.seek) {
+      int result = (*ft->handler.seek)(ft, offset);
+      if (result == SOX_SUCCESS && ft->mode == 'r')
+        ft->olength = offset; /* So that sox_read's length limit still holds */
+      return result;
+    }
     return SOX_EOF; /* FIXME: return SOX_EBADF */
 }
 
@@ -44,6 +44,9 @@
   FORMAT(s3)
   FORMAT(s4)
   FORMAT(sf)
+#if defined HAVE_CLOCK_GETTIME && defined HAVE_NANOSLEEP
+  FORMAT(simdev)
+#endif
   FORMAT(sln)
   FORMAT(smp)
   FORMAT(sounder)
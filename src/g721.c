@@ -71,6 +71,9 @@ static const short	_witab[16] = {-12, 18, 41, 64, 112, 198, 355, 1122,
 static const short	_fitab[16] = {0, 0, 0, 0x200, 0x200, 0x200, 0x600, 0xE00,
 				0xE00, 0x600, 0x200, 0x200, 0x200, 0, 0, 0};
 
+lsx_g72x_codec_t const lsx_g721_codec = {
+	4, qtab_721, 7, _dqlntab, _witab, 5, _fitab, 0x3FFF, 1};
+
 /*
  * g721_encoder()
  *
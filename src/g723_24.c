@@ -58,6 +58,9 @@ static const short	_fitab[8] = {0, 0x200, 0x400, 0xE00, 0xE00, 0x400, 0x200, 0};
 
 static const short qtab_723_24[3] = {8, 218, 331};
 
+lsx_g72x_codec_t const lsx_g723_24_codec = {
+	3, qtab_723_24, 3, _dqlntab, _witab, 0, _fitab, 0x3FFF, 0};
+
 /*
  * g723_24_encoder()
  *
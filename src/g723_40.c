@@ -76,6 +76,9 @@ static const short	_fitab[32] = {0, 0, 0, 0, 0, 0x200, 0x200, 0x200,
 static const short qtab_723_40[15] = {-122, -16, 68, 139, 198, 250, 298, 339,
 				378, 413, 445, 475, 502, 528, 553};
 
+lsx_g72x_codec_t const lsx_g723_40_codec = {
+	5, qtab_723_40, 15, _dqlntab, _witab, 0, _fitab, 0x7FFF, 0};
+
 /*
  * g723_40_encoder()
  *
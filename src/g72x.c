@@ -95,16 +95,16 @@ static inline int log2plus1(int val)
  * quantizes the input val against the table of size short integers.
  * It returns i if table[i - 1] <= val < table[i].
  *
- * Using linear search for simple coding.
+ * The tables are in ascending order, so this is the number of entries
+ * not greater than val; counting them avoids a data-dependent branch.
  */
 static int quan(int val, short const *table, int size)
 {
-        int             i;
+        int             i, n = 0;
 
         for (i = 0; i < size; i++)
-                if (val < *table++)
-                        break;
-        return (i);
+                n += val >= table[i];
+        return (n);
 }
 
 /*
@@ -112,18 +112,21 @@ static int quan(int val, short const *table, int size)
  *
  * returns the integer product of the 14-bit integer "an" and
  * "floating point" representation (4-bit exponent, 6-bit mantessa) "srn".
+ * an's magnitude fits in 13 bits, so its exponent is found exactly by
+ * conversion to float, without branches or table look-ups.
  */
-static int fmult(int an, int srn)
+static inline int fmult(int an, int srn)
 {
-        short           anmag, anexp, anmant;
-        short           wanexp, wanmant;
-        short           retval;
+        union {float f; int32_t i;} u;
+        int             anmag, anlog, anmant;
+        int             wanexp, wanmant;
+        int             retval;
 
         anmag = (an > 0) ? an : ((-an) & 0x1FFF);
-        anexp = log2plus1(anmag) - 6;
-        anmant = (anmag == 0) ? 32 :
-            (anexp >= 0) ? anmag >> anexp : anmag << -anexp;
-        wanexp = anexp + ((srn >> 6) & 0xF) - 13;
+        u.f = anmag | 1;
+        anlog = (u.i >> 23) - 126;              /* log2plus1(anmag) */
+        anmant = (anmag == 0) ? 32 : (anmag << 6) >> anlog;
+        wanexp = anlog + ((srn >> 6) & 0xF) - 19;
 
         wanmant = (anmant * (srn & 077) + 0x30) >> 4;
         retval = (wanexp >= 0) ? ((wanmant << wanexp) & 0x7FFF) :
@@ -573,3 +576,133 @@ int tandem_adjust_ulaw(int sr, int se, int y, int i, int sign, short const *qtab
                 return (sd);
         }
 }
+
+/*
+ * Multi-lane engine.  Each lane has its own struct g72x_state, coded by
+ * the same predictor_*, step_size and update routines as the single-stream
+ * coders.  Lanes are coded in turn for each frame, so that their
+ * independent dependency chains overlap in the processor.
+ * Lanes are split between threads when there are enough of them.
+ */
+#define G72X_LANE_GROUP 16      /* Lanes per thread work item */
+
+struct lsx_g72x_batch {
+        lsx_g72x_codec_t const * codec;
+        unsigned        lanes;
+        struct g72x_state * state;
+};
+
+lsx_g72x_batch_t * lsx_g72x_batch_create(lsx_g72x_codec_t const *codec,
+                                         unsigned lanes)
+{
+        lsx_g72x_batch_t * p = lsx_calloc(1, sizeof(*p));
+
+        p->codec = codec;
+        p->lanes = lanes;
+        p->state = lsx_calloc(lanes, sizeof(*p->state));
+        lsx_g72x_batch_reset(p);
+        return p;
+}
+
+/* As g72x_init_state, for every lane. */
+void lsx_g72x_batch_reset(lsx_g72x_batch_t *p)
+{
+        unsigned        k;
+
+        for (k = 0; k < p->lanes; k++)
+                g72x_init_state(&p->state[k]);
+}
+
+void lsx_g72x_batch_delete(lsx_g72x_batch_t *p)
+{
+        if (p) {
+                free(p->state);
+                free(p);
+        }
+}
+
+/*
+ * Codes one sample on lane k: x is a 16-bit linear sample when encoding
+ * (the code is returned), or a code when decoding (the 16-bit sample is
+ * returned).  The short locals match those of the single-stream coders.
+ */
+static inline int lane_code(lsx_g72x_batch_t *p, unsigned k, int x,
+                            sox_bool encode)
+{
+        lsx_g72x_codec_t const * c = p->codec;
+        struct g72x_state * state_ptr = &p->state[k];
+        short           sezi, sei, se, sez;     /* ACCUM */
+        short           d;                      /* SUBTA */
+        short           y;                      /* MIX */
+        short           sr;                     /* ADDB */
+        short           dqsez;                  /* ADDC */
+        short           dq, i;
+        int             pole;
+
+        sezi = predictor_zero(state_ptr);
+        sez = sezi >> 1;
+        pole = predictor_pole(state_ptr);
+        if (encode && c->wide_se)
+                se = (sezi + pole) >> 1;
+        else {
+                sei = sezi + pole;
+                se = sei >> 1;
+        }
+
+        y = step_size(state_ptr);
+        if (encode) {
+                d = (x >> 2) - se;
+                i = quantize(d, y, c->qtab, c->qtab_size);
+        } else
+                i = x & ((1 << c->code_size) - 1);
+
+        dq = reconstruct(i & (1 << (c->code_size - 1)), c->dqlntab[i], y);
+        sr = (dq < 0) ? se - (dq & c->dq_mask) : se + dq;
+        dqsez = sr + sez - se;
+        update(c->code_size, y, c->witab[i] << c->wi_shift, c->fitab[i], dq,
+            sr, dqsez, state_ptr);
+        return encode ? i : sr << 2;
+}
+
+static void lanes_code(lsx_g72x_batch_t *p, void const *in, void *out,
+                       size_t frames, sox_bool encode)
+{
+        unsigned        lanes = p->lanes;
+        int             g, groups = (lanes + G72X_LANE_GROUP - 1) / G72X_LANE_GROUP;
+
+#ifdef HAVE_OPENMP
+        #pragma omp parallel for if(sox_globals.use_threads && groups > 1) schedule(static)
+#endif
+        for (g = 0; g < groups; g++) {
+                unsigned        k0 = g * G72X_LANE_GROUP;
+                unsigned        k1 = min(k0 + G72X_LANE_GROUP, lanes), k;
+                size_t          n, j;
+
+                for (n = 0; n < frames; n++) {
+                        j = n * lanes;
+                        if (encode) {
+                                int const * s = (int const *)in + j;
+                                unsigned char * c = (unsigned char *)out + j;
+                                for (k = k0; k < k1; k++)
+                                        c[k] = lane_code(p, k, s[k], sox_true);
+                        } else {
+                                unsigned char const * c = (unsigned char const *)in + j;
+                                int * s = (int *)out + j;
+                                for (k = k0; k < k1; k++)
+                                        s[k] = lane_code(p, k, c[k], sox_false);
+                        }
+                }
+        }
+}
+
+void lsx_g72x_batch_encode(lsx_g72x_batch_t *p, int const *in,
+                           unsigned char *codes, size_t frames)
+{
+        lanes_code(p, in, codes, frames, sox_true);
+}
+
+void lsx_g72x_batch_decode(lsx_g72x_batch_t *p, unsigned char const *codes,
+                           int *out, size_t frames)
+{
+        lanes_code(p, codes, out, frames, sox_false);
+}
@@ -154,4 +154,39 @@ int tandem_adjust_ulaw(int sr,
 		       int i,
 		       int sign,
 		       short const *qtab);
+
+/*
+ * Multi-lane engine: codes any number of independent G.721/G.723 streams
+ * ("lanes") in step, each with its own struct g72x_state.  Samples
+ * and codes are interleaved by lane; samples are 16-bit linear PCM, though
+ * as with the single-stream decoders, overshoot may take a decoded sample
+ * beyond 16 bits.  The output is bit-exact with the routines above.
+ */
+typedef struct {
+	int code_size;		/* Bits per code: 3, 4 or 5. */
+	short const *qtab;	/* Quantizer decision levels. */
+	int qtab_size;
+	short const *dqlntab;	/* Code to normalized log magnitude. */
+	short const *witab;	/* Code to log scale factor multiplier. */
+	int wi_shift;		/* Scaling applied to witab entries. */
+	short const *fitab;	/* Code to speed control value. */
+	int dq_mask;		/* Magnitude mask for negative dq. */
+	int wide_se;		/* Encoder forms se without truncating sei. */
+} lsx_g72x_codec_t;
+
+extern lsx_g72x_codec_t const lsx_g721_codec;
+extern lsx_g72x_codec_t const lsx_g723_24_codec;
+extern lsx_g72x_codec_t const lsx_g723_40_codec;
+
+typedef struct lsx_g72x_batch lsx_g72x_batch_t;
+
+lsx_g72x_batch_t * lsx_g72x_batch_create(lsx_g72x_codec_t const *codec,
+					 unsigned lanes);
+void lsx_g72x_batch_reset(lsx_g72x_batch_t *batch);
+void lsx_g72x_batch_encode(lsx_g72x_batch_t *batch, int const *in,
+			   unsigned char *codes, size_t frames);
+void lsx_g72x_batch_decode(lsx_g72x_batch_t *batch,
+			   unsigned char const *codes, int *out,
+			   size_t frames);
+void lsx_g72x_batch_delete(lsx_g72x_batch_t *batch);
 #endif /* !_G72X_H */
@@ -41,6 +41,9 @@ static const int imaStepSizeTable[ISSTMAX + 1] = {
         27086, 29794, 32767
 };
 
+/* samples used by lsx_ima_block_prime_i() to settle the step index */
+#define IMA_PRIME_SAMPLES 64
+
 #define imaStateAdjust(c) (((c)<4)? -1:(2*(c)-6))
 /* +0 - +3, decrease step size */
 /* +4 - +7, increase step size */
@@ -309,6 +312,26 @@ void lsx_ima_block_mash_i(
                 ImaMashChannel(ch, chans, ip, n, st+ch, obuff, opt);
 }
 
+/* estimate the state lsx_ima_block_mash_i() leaves after encoding ip[],
+ * without depending on the state it started from, so that the following
+ * block can be encoded independently of this one */
+void lsx_ima_block_prime_i(
+        unsigned chans,          /* total channels */
+        const SAMPL *ip,    /* ip[] is interleaved input samples */
+        int n,              /* samples PER channel in ip[] */
+        int *st             /* output state[chans] */
+)
+{
+        unsigned ch;
+        int m = n < IMA_PRIME_SAMPLES? n : IMA_PRIME_SAMPLES;
+
+        ip += (n - m) * chans; /* the step index settles within a few samples */
+        for (ch=0; ch<chans; ch++) {
+                st[ch] = 0;
+                ImaMashS(ch, chans, ip[ch], ip, m, st+ch, NULL);
+        }
+}
+
 /*
  * lsx_ima_samples_in(dataLen, chans, blockAlign, samplesPerBlock)
  *  returns the number of samples/channel which would go
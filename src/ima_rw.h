@@ -55,6 +55,15 @@ extern void lsx_ima_block_mash_i(
 	int opt             /* non-zero allows some cpu-intensive code to improve output */
 );
 
+/* estimate the output state of lsx_ima_block_mash_i() for ip[] without
+ * depending on its input state, so blocks can be mashed independently */
+extern void lsx_ima_block_prime_i(
+	unsigned chans,          /* total channels */
+	const SAMPL *ip,    /* ip[] is interleaved input samples */
+	int n,              /* samples PER channel in ip[] */
+	int *st             /* output state[chans] */
+);
+
 /* Some helper functions for computing samples/block and blockalign */
 
 /*
@@ -54,8 +54,15 @@ typedef struct {
   LADSPA_Data *latency_control_port;
   unsigned long in_latency;
   unsigned long out_latency;
+  sox_bool parallel;            /* run the handles concurrently */
+  void *mem;                    /* port buffers, as allocated */
+  LADSPA_Data *buf, *outbuf;    /* port buffers, aligned */
+  size_t stride;                /* frames per port buffer */
 } priv_t;
 
+#define ALIGN 64                /* bytes; suits any vector unit */
+#define STRIDE_ALIGN (ALIGN / sizeof(LADSPA_Data))
+
 static LADSPA_Data ladspa_default(const LADSPA_PortRangeHint *p)
 {
   LADSPA_Data d;
@@ -218,6 +225,36 @@ static int sox_ladspa_getopts(sox_effect_t *effp, int argc, char **argv)
   return argc? lsx_usage(effp) : SOX_SUCCESS;
 }
 
+/*
+ * Allocate the audio port buffers, aligned, with room for at least the
+ * given number of frames per port, and connect the ports to them.  The
+ * buffers persist until stop, so this does anything only when a flow
+ * call asks for more frames than any before it.
+ */
+static void connect_audio_ports(priv_t * l_st, size_t frames)
+{
+  const size_t total_input_count = l_st->input_count * l_st->handle_count;
+  const size_t total_output_count = l_st->output_count * l_st->handle_count;
+  size_t j;
+
+  if (frames <= l_st->stride && l_st->mem)
+    return;
+  l_st->stride = (frames + STRIDE_ALIGN - 1) / STRIDE_ALIGN * STRIDE_ALIGN;
+  free(l_st->mem);
+  l_st->mem = lsx_calloc(ALIGN + (total_input_count + total_output_count) *
+                         l_st->stride * sizeof(LADSPA_Data), (size_t)1);
+  l_st->buf = (LADSPA_Data *)((char *)l_st->mem +
+                              (ALIGN - (size_t)l_st->mem % ALIGN) % ALIGN);
+  l_st->outbuf = l_st->buf + total_input_count * l_st->stride;
+
+  for (j = 0; j < total_input_count; j++)
+    l_st->desc->connect_port(l_st->handles[j / l_st->input_count],
+        l_st->inputs[j / l_st->handle_count], l_st->buf + j * l_st->stride);
+  for (j = 0; j < total_output_count; j++)
+    l_st->desc->connect_port(l_st->handles[j / l_st->output_count],
+        l_st->outputs[j / l_st->handle_count], l_st->outbuf + j * l_st->stride);
+}
+
 /*
  * Prepare processing.
  */
@@ -309,6 +346,14 @@ static int sox_ladspa_start(sox_effect_t * effp)
     }
   }
 
+  connect_audio_ports(l_st, sox_globals.bufsiz /
+      max(l_st->input_count * l_st->handle_count, 1));
+
+  /* Separate instances may run at once only if the plugin does no I/O,
+   * memory allocation, etc. that might serialise them */
+  l_st->parallel = sox_globals.use_threads && l_st->handle_count > 1 &&
+      LADSPA_IS_HARD_RT_CAPABLE(l_st->desc->Properties);
+
   /* If needed, activate the plugin instances */
   if (l_st->desc->activate) {
     for (h = 0; h < l_st->handle_count; h++)
@@ -325,56 +370,38 @@ static int sox_ladspa_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sa
                            size_t *isamp, size_t *osamp)
 {
   priv_t * l_st = (priv_t *)effp->priv;
-  size_t i, len = min(*isamp, *osamp);
-  size_t j;
-  size_t h;
+  size_t i, j;
+  int h;
   const size_t total_input_count = l_st->input_count * l_st->handle_count;
   const size_t total_output_count = l_st->output_count * l_st->handle_count;
-  const size_t input_len = len / total_input_count;
-  size_t output_len = len / total_output_count;
-
-  if (total_output_count < total_input_count)
-    output_len = input_len;
+  const size_t len = min(*isamp / total_input_count, *osamp / total_output_count);
 
-  *isamp = len;
+  *isamp = len * total_input_count;
   *osamp = 0;
 
   if (len) {
-    LADSPA_Data *buf = lsx_calloc(len, sizeof(LADSPA_Data));
-    LADSPA_Data *outbuf = lsx_calloc(len, sizeof(LADSPA_Data));
-    LADSPA_Handle handle;
-    unsigned long port, l;
+    unsigned long l;
     SOX_SAMPLE_LOCALS;
 
+    connect_audio_ports(l_st, len);
+
     /*
      * prepare buffer for LADSPA input
-     * deinterleave sox samples and write non-interleaved data to
-     * input_port-specific buffer locations
+     * deinterleave sox samples into the input port buffers
      */
-    for (i = 0; i < input_len; i++) {
-      for (j = 0; j < total_input_count; j++) {
-        const sox_sample_t s = *ibuf++;
-        buf[j * input_len + i] = SOX_SAMPLE_TO_LADSPA_DATA(s, effp->clips);
-      }
-    }
-
-    /* Connect the LADSPA input port(s) to the prepared buffers */
     for (j = 0; j < total_input_count; j++) {
-      handle = l_st->handles[j / l_st->input_count];
-      port = l_st->inputs[j / l_st->handle_count];
-      l_st->desc->connect_port(handle, port, buf + j * input_len);
-    }
-
-    /* Connect the LADSPA output port(s) if used */
-    for (j = 0; j < total_output_count; j++) {
-      handle = l_st->handles[j / l_st->output_count];
-      port = l_st->outputs[j / l_st->handle_count];
-      l_st->desc->connect_port(handle, port, outbuf + j * output_len);
+      LADSPA_Data *d = l_st->buf + j * l_st->stride;
+      const sox_sample_t *s = ibuf + j;
+      for (i = 0; i < len; i++, s += total_input_count)
+        d[i] = SOX_SAMPLE_TO_LADSPA_DATA(*s, effp->clips);
     }
 
     /* Run the plugin for each handle */
-    for (h = 0; h < l_st->handle_count; h++)
-      l_st->desc->run(l_st->handles[h], input_len);
+#ifdef HAVE_OPENMP
+    #pragma omp parallel for if(l_st->parallel) schedule(static)
+#endif
+    for (h = 0; h < (int)l_st->handle_count; h++)
+      l_st->desc->run(l_st->handles[h], len);
 
     /* check the latency control port if we have one */
     if (l_st->latency_control_port) {
@@ -389,18 +416,15 @@ static int sox_ladspa_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sa
     }
 
     /* Grab output if effect produces it, re-interleaving it */
-    l = min(output_len, l_st->in_latency);
-    for (i = l; i < output_len; i++) {
-      for (j = 0; j < total_output_count; j++) {
-        LADSPA_Data d = outbuf[j * output_len + i];
-        *obuf++ = LADSPA_DATA_TO_SOX_SAMPLE(d, effp->clips);
-        (*osamp)++;
-      }
+    l = min(len, l_st->in_latency);
+    for (j = 0; j < total_output_count; j++) {
+      const LADSPA_Data *s = l_st->outbuf + j * l_st->stride;
+      sox_sample_t *d = obuf + j;
+      for (i = l; i < len; i++, d += total_output_count)
+        *d = LADSPA_DATA_TO_SOX_SAMPLE(s[i], effp->clips);
     }
+    *osamp = (len - l) * total_output_count;
     l_st->in_latency -= l;
-
-    free(outbuf);
-    free(buf);
   }
 
   return SOX_SUCCESS;
@@ -456,6 +480,9 @@ static int sox_ladspa_stop(sox_effect_t * effp)
   }
   free(l_st->handles);
   l_st->handle_count = 0;
+  free(l_st->mem);
+  l_st->mem = NULL;
+  l_st->stride = 0;
 
   return SOX_SUCCESS;
 }
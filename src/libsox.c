@@ -134,7 +134,11 @@ static sox_globals_t s_sox_globals = {
   NULL,            /* char       * tmp_path */
   sox_false,       /* sox_bool     use_magic */
   sox_false,       /* sox_bool     use_threads */
-  10               /* size_t       log2_dft_min_size */
+  10,              /* size_t       log2_dft_min_size */
+  0,               /* size_t       device_buffer */
+  0,               /* size_t       device_period */
+  0,               /* size_t       capture_buffer */
+  sox_false        /* sox_bool     quick_length */
 };
 
 sox_globals_t * sox_get_globals(void)
@@ -149,12 +149,13 @@ static size_t mp3_duration(sox_format_t * ft)
       }
       else vbr |= mad_header.bitrate != initial_bitrate;
 
-      /* If not VBR, we can time just a few frames then extrapolate */
-      if (++frames == 25 && !vbr) {
+      /* If not VBR (or only an estimate is wanted), we can time just a few
+       * frames then extrapolate */
+      if (++frames == 25 && (!vbr || sox_globals.quick_length)) {
         double frame_size = (double) consumed / frames;
         size_t num_frames = (lsx_filelength(ft) - tagsize) / frame_size;
         num_samples = num_samples / frames * num_frames;
-        lsx_debug("got approx. duration by CBR extrapolation");
+        lsx_debug("got approx. duration by %s extrapolation", vbr? "VBR" : "CBR");
         break;
       }
     }
@@ -37,7 +37,7 @@
 typedef struct {
   /* Decoding data */
   OggOpusFile *of;
-  char *buf;
+  float *buf;
   size_t buf_len;
   size_t start;
   size_t end;     /* Unsent data samples in buf[start] through buf[end-1] */
@@ -126,8 +126,8 @@ static int startread(sox_format_t * ft)
 
   /* Setup buffer */
   vb->buf_len = DEF_BUF_LEN;
-  vb->buf_len -= vb->buf_len % (ft->signal.channels*2); /* 2 bytes per sample */
-  vb->buf = lsx_calloc(vb->buf_len, sizeof(char));
+  vb->buf_len -= vb->buf_len % ft->signal.channels;
+  vb->buf = lsx_calloc(vb->buf_len, sizeof(*vb->buf));
   vb->start = vb->end = 0;
 
   /* Fill in other info */
@@ -150,9 +150,9 @@ static int refill_buffer(sox_format_t * ft)
     vb->start = vb->end = 0;
 
   while (vb->end < vb->buf_len) {
-    num_read = op_read(vb->of, (opus_int16*) (vb->buf + vb->end),
-        (int) ((vb->buf_len - vb->end) / sizeof(opus_int16)),
-        &vb->current_section);
+    /* Decode to float so as not to lose the decoder's full precision */
+    num_read = op_read_float(vb->of, vb->buf + vb->end,
+        (int) (vb->buf_len - vb->end), &vb->current_section);
     if (num_read == 0)
       return (BUF_EOF);
     else if (num_read == OP_HOLE)
@@ -160,7 +160,7 @@ static int refill_buffer(sox_format_t * ft)
     else if (num_read < 0)
       return (BUF_ERROR);
     else
-      vb->end += num_read * sizeof(opus_int16) * ft->signal.channels;
+      vb->end += num_read * ft->signal.channels;
   }
   return (BUF_DATA);
 }
@@ -176,12 +176,11 @@ static int refill_buffer(sox_format_t * ft)
 static size_t read_samples(sox_format_t * ft, sox_sample_t * buf, size_t len)
 {
   priv_t * vb = (priv_t *) ft->priv;
-  size_t i;
+  size_t i = 0, n;
   int ret;
-  sox_sample_t l;
+  SOX_SAMPLE_LOCALS;
 
-
-  for (i = 0; i < len; i++) {
+  while (i < len) {
     if (vb->start == vb->end) {
       if (vb->eof)
         break;
@@ -193,10 +192,9 @@ static size_t read_samples(sox_format_t * ft, sox_sample_t * buf, size_t len)
       }
     }
 
-    l = (vb->buf[vb->start + 1] << 24)
-        | (0xffffff & (vb->buf[vb->start] << 16));
-    *(buf + i) = l;
-    vb->start += 2;
+    n = min(len - i, vb->end - vb->start);
+    for (; n; --n)
+      buf[i++] = SOX_FLOAT_32BIT_TO_SAMPLE(vb->buf[vb->start++], ft->clips);
   }
   return i;
 }
@@ -219,7 +217,12 @@ static int seek(sox_format_t * ft, uint64_t offset)
 {
   priv_t * vb = (priv_t *) ft->priv;
 
-  return op_pcm_seek(vb->of, (opus_int64)(offset / ft->signal.channels))? SOX_EOF:SOX_SUCCESS;
+  if (op_pcm_seek(vb->of, (opus_int64)(offset / ft->signal.channels)))
+    return SOX_EOF;
+  /* Drop what was decoded before the seek, and any end reached */
+  vb->start = vb->end = 0;
+  vb->eof = 0;
+  return SOX_SUCCESS;
 }
 
 LSX_FORMAT_HANDLER(opus)
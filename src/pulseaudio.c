@@ -5,13 +5,193 @@
 
 #include "sox_i.h"
 
+#include <pulse/pulseaudio.h>
 #include <pulse/simple.h>
 #include <pulse/error.h>
 
+/* Audio is exchanged through a pa_stream driven by a threaded main loop,
+ * which allows the buffer attributes to be set and under/overflows to be
+ * counted.  If that cannot be set up, pa_simple is used instead. */
 typedef struct {
   pa_simple *pasp;
+
+  pa_threaded_mainloop *mainloop;
+  pa_context *context;
+  pa_stream *stream;
+  size_t frame_size;
+  size_t tlength;               /* Playback target buffer length (bytes) */
+  void const *frag;             /* Recorded fragment being consumed */
+  size_t frag_len, frag_pos;
+  sox_uint64_t xruns;           /* Updated by the main loop thread */
 } priv_t;
 
+/* Main loop thread callbacks; these are called with the main loop locked. */
+
+static void context_state_cb(pa_context *c, void *userdata)
+{
+  priv_t *pa = (priv_t *)userdata;
+  (void)c;
+  pa_threaded_mainloop_signal(pa->mainloop, 0);
+}
+
+static void stream_cb(pa_stream *s, void *userdata)
+{
+  priv_t *pa = (priv_t *)userdata;
+  (void)s;
+  pa_threaded_mainloop_signal(pa->mainloop, 0);
+}
+
+static void stream_request_cb(pa_stream *s, size_t nbytes, void *userdata)
+{
+  (void)nbytes;
+  stream_cb(s, userdata);
+}
+
+static void stream_xrun_cb(pa_stream *s, void *userdata)
+{
+  priv_t *pa = (priv_t *)userdata;
+  (void)s;
+  ++pa->xruns;
+}
+
+static void stream_success_cb(pa_stream *s, int success, void *userdata)
+{
+  (void)success;
+  stream_cb(s, userdata);
+}
+
+/* Returns whether the stream can still be used; the main loop must be
+ * locked. */
+static sox_bool stream_ok(sox_format_t *ft)
+{
+  priv_t *pa = (priv_t *)ft->priv;
+
+  if (pa_context_get_state(pa->context) == PA_CONTEXT_READY &&
+      pa_stream_get_state(pa->stream) == PA_STREAM_READY)
+    return sox_true;
+  lsx_fail_errno(ft, SOX_EPERM, "pulse audio stream failed: %s",
+      pa_strerror(pa_context_errno(pa->context)));
+  return sox_false;
+}
+
+/* Copies the statistics gathered by the main loop thread, and the current
+ * buffer fill, to ft->device; the main loop must be locked. */
+static void update_stats(sox_format_t *ft)
+{
+  priv_t *pa = (priv_t *)ft->priv;
+  sox_device_stats_t *d = &ft->device;
+  size_t n;
+
+  d->xruns = pa->xruns;
+  if (ft->mode == 'r')
+    n = pa_stream_readable_size(pa->stream);
+  else {
+    n = pa_stream_writable_size(pa->stream);
+    n = pa->tlength - min(n, pa->tlength);
+  }
+  if (n == (size_t)-1)
+    return;
+  d->fill = n / pa->frame_size;
+  d->fill_min = min(d->fill_min, d->fill);
+  d->fill_max = max(d->fill_max, d->fill);
+}
+
+static void stop_stream(priv_t *pa)
+{
+  if (pa->mainloop)
+    pa_threaded_mainloop_stop(pa->mainloop);
+  if (pa->stream) {
+    pa_stream_disconnect(pa->stream);
+    pa_stream_unref(pa->stream);
+  }
+  if (pa->context) {
+    pa_context_disconnect(pa->context);
+    pa_context_unref(pa->context);
+  }
+  if (pa->mainloop)
+    pa_threaded_mainloop_free(pa->mainloop);
+  pa->mainloop = NULL, pa->context = NULL, pa->stream = NULL;
+}
+
+static int setup_stream(sox_format_t *ft, char const *server, char const *dev,
+    char const *app_str, pa_sample_spec const *spec)
+{
+  priv_t *pa = (priv_t *)ft->priv;
+  pa_buffer_attr attr;
+  pa_buffer_attr const *actual;
+  pa_stream_flags_t flags = PA_STREAM_INTERPOLATE_TIMING |
+    PA_STREAM_AUTO_TIMING_UPDATE;
+  pa_context_state_t cstate;
+  pa_stream_state_t sstate;
+  int error;
+
+  pa->frame_size = pa_frame_size(spec);
+  if (!(pa->mainloop = pa_threaded_mainloop_new()) ||
+      !(pa->context = pa_context_new(pa_threaded_mainloop_get_api(pa->mainloop), "SoX"))) {
+    lsx_debug("can not create pulse audio main loop");
+    stop_stream(pa);
+    return SOX_EOF;
+  }
+  pa_context_set_state_callback(pa->context, context_state_cb, pa);
+  pa_threaded_mainloop_lock(pa->mainloop);
+  if (pa_context_connect(pa->context, server, PA_CONTEXT_NOFLAGS, NULL) < 0 ||
+      pa_threaded_mainloop_start(pa->mainloop) < 0)
+    goto error;
+  while ((cstate = pa_context_get_state(pa->context)) != PA_CONTEXT_READY) {
+    if (!PA_CONTEXT_IS_GOOD(cstate))
+      goto error;
+    pa_threaded_mainloop_wait(pa->mainloop);
+  }
+
+  if (!(pa->stream = pa_stream_new(pa->context, app_str, spec, NULL)))
+    goto error;
+  pa_stream_set_state_callback(pa->stream, stream_cb, pa);
+  pa_stream_set_read_callback(pa->stream, stream_request_cb, pa);
+  pa_stream_set_write_callback(pa->stream, stream_request_cb, pa);
+  pa_stream_set_underflow_callback(pa->stream, stream_xrun_cb, pa);
+  pa_stream_set_overflow_callback(pa->stream, stream_xrun_cb, pa);
+
+  /* (uint32_t)-1 lets the server choose: */
+  attr.maxlength = attr.tlength = attr.prebuf = attr.minreq =
+    attr.fragsize = (uint32_t)-1;
+  if (sox_globals.device_buffer)
+    attr.tlength = attr.fragsize = sox_globals.device_buffer * pa->frame_size;
+  if (sox_globals.device_period)
+    attr.minreq = attr.fragsize = sox_globals.device_period * pa->frame_size;
+  if (sox_globals.device_buffer || sox_globals.device_period)
+    flags |= PA_STREAM_ADJUST_LATENCY;
+
+  error = ft->mode == 'r'?
+    pa_stream_connect_record(pa->stream, dev, &attr, flags) :
+    pa_stream_connect_playback(pa->stream, dev, &attr, flags, NULL, NULL);
+  if (error < 0)
+    goto error;
+  while ((sstate = pa_stream_get_state(pa->stream)) != PA_STREAM_READY) {
+    if (!PA_STREAM_IS_GOOD(sstate))
+      goto error;
+    pa_threaded_mainloop_wait(pa->mainloop);
+  }
+
+  if ((actual = pa_stream_get_buffer_attr(pa->stream))) {
+    pa->tlength = actual->tlength;
+    ft->device.buffer_size = (ft->mode == 'r'? actual->fragsize :
+        actual->tlength) / pa->frame_size;
+    lsx_report("buffer %" PRIu64 " frames (%s %u bytes)", ft->device.buffer_size,
+        ft->mode == 'r'? "fragsize" : "tlength",
+        ft->mode == 'r'? actual->fragsize : actual->tlength);
+  }
+  ft->device.fill_min = ft->device.buffer_size;
+  pa_threaded_mainloop_unlock(pa->mainloop);
+  return SOX_SUCCESS;
+
+error:
+  lsx_debug("can not set up pulse audio stream: %s",
+      pa_strerror(pa_context_errno(pa->context)));
+  pa_threaded_mainloop_unlock(pa->mainloop);
+  stop_stream(pa);
+  return SOX_EOF;
+}
+
 static int setup(sox_format_t *ft, int is_input)
 {
   priv_t *pa = (priv_t *)ft->priv;
@@ -57,11 +237,15 @@ static int setup(sox_format_t *ft, int is_input)
     ft->encoding.bits_per_sample = 16;
     ft->encoding.encoding = SOX_ENCODING_SIGN2;
   }
- 
+
   spec.format = PA_SAMPLE_S32NE;
   spec.rate = ft->signal.rate;
   spec.channels = ft->signal.channels;
 
+  if (setup_stream(ft, server, dev, app_str, &spec) == SOX_SUCCESS)
+    return SOX_SUCCESS;
+  lsx_report("using the pulse audio simple API");
+
   pa->pasp = pa_simple_new(server, "SoX", dir, dev, app_str, &spec,
                           NULL, NULL, &error);
 
@@ -89,17 +273,67 @@ static int stopread(sox_format_t * ft)
 {
   priv_t *pa = (priv_t *)ft->priv;
 
-  pa_simple_free(pa->pasp);
+  if (pa->pasp)
+    pa_simple_free(pa->pasp);
+  else {
+    if (ft->device.xruns)
+      lsx_report("%" PRIu64 " over-runs", ft->device.xruns);
+    stop_stream(pa);
+  }
 
   return SOX_SUCCESS;
 }
 
+/* Copies recorded fragments straight from the stream's buffer to buf. */
+static size_t read_stream(sox_format_t *ft, sox_sample_t *buf, size_t nsamp)
+{
+  priv_t *pa = (priv_t *)ft->priv;
+  size_t len = nsamp * sizeof(sox_sample_t), done = 0, n;
+
+  pa_threaded_mainloop_lock(pa->mainloop);
+  while (done < len) {
+    if (!pa->frag_len) {
+      while (!pa_stream_readable_size(pa->stream)) {
+        if (!stream_ok(ft))
+          goto error;
+        pa_threaded_mainloop_wait(pa->mainloop);
+      }
+      if (pa_stream_peek(pa->stream, &pa->frag, &pa->frag_len) < 0) {
+        stream_ok(ft);
+        goto error;
+      }
+      pa->frag_pos = 0;
+      if (!pa->frag_len)
+        continue;
+    }
+    n = min(len - done, pa->frag_len - pa->frag_pos);
+    if (pa->frag)
+      memcpy((char *)buf + done, (char const *)pa->frag + pa->frag_pos, n);
+    else memset((char *)buf + done, 0, n);    /* A hole in the stream */
+    done += n;
+    if ((pa->frag_pos += n) == pa->frag_len) {
+      pa_stream_drop(pa->stream);
+      pa->frag_len = 0;
+    }
+  }
+  update_stats(ft);
+  pa_threaded_mainloop_unlock(pa->mainloop);
+  return nsamp;
+
+error:
+  pa_threaded_mainloop_unlock(pa->mainloop);
+  return done / sizeof(sox_sample_t);
+}
+
 static size_t read_samples(sox_format_t *ft, sox_sample_t *buf, size_t nsamp)
 {
   priv_t *pa = (priv_t *)ft->priv;
   size_t len;
   int rc, error;
 
+  if (!pa->pasp)
+    return read_stream(ft, buf, nsamp);
+
   /* Pulse Audio buffer lengths are true buffer lengths and not
    * count of samples. */
   len = nsamp * sizeof(sox_sample_t);
@@ -109,7 +343,7 @@ static size_t read_samples(sox_format_t *ft, sox_sample_t *buf, size_t nsamp)
   if (rc < 0)
   {
     lsx_fail_errno(ft, SOX_EPERM, "error reading from pulse audio device: %s", pa_strerror(error));
-    return SOX_EOF;
+    return 0;
   }
   else
     return nsamp;
@@ -120,6 +354,46 @@ static int startwrite(sox_format_t * ft)
     return setup(ft, 0);
 }
 
+/* Copies samples straight into the stream's buffer. */
+static size_t write_stream(sox_format_t *ft, const sox_sample_t *buf, size_t nsamp)
+{
+  priv_t *pa = (priv_t *)ft->priv;
+  size_t len = nsamp * sizeof(sox_sample_t), done = 0, n;
+  void *data;
+
+  pa_threaded_mainloop_lock(pa->mainloop);
+  while (done < len) {
+    while (!(n = pa_stream_writable_size(pa->stream))) {
+      if (!stream_ok(ft))
+        goto error;
+      pa_threaded_mainloop_wait(pa->mainloop);
+    }
+    if (n == (size_t)-1) {
+      stream_ok(ft);
+      goto error;
+    }
+    n = min(n, len - done);
+    if (pa_stream_begin_write(pa->stream, &data, &n) < 0) {
+      stream_ok(ft);
+      goto error;
+    }
+    n = min(n, len - done);
+    memcpy(data, (char const *)buf + done, n);
+    if (pa_stream_write(pa->stream, data, n, NULL, 0, PA_SEEK_RELATIVE) < 0) {
+      stream_ok(ft);
+      goto error;
+    }
+    done += n;
+  }
+  update_stats(ft);
+  pa_threaded_mainloop_unlock(pa->mainloop);
+  return nsamp;
+
+error:
+  pa_threaded_mainloop_unlock(pa->mainloop);
+  return done / sizeof(sox_sample_t);
+}
+
 static size_t write_samples(sox_format_t *ft, const sox_sample_t *buf, size_t nsamp)
 {
   priv_t *pa = (priv_t *)ft->priv;
@@ -129,6 +403,9 @@ static size_t write_samples(sox_format_t *ft, const sox_sample_t *buf, size_t ns
   if (!nsamp)
     return 0;
 
+  if (!pa->pasp)
+    return write_stream(ft, buf, nsamp);
+
   /* Pulse Audio buffer lengths are true buffer lengths and not
    * count of samples. */
   len = nsamp * sizeof(sox_sample_t);
@@ -138,7 +415,7 @@ static size_t write_samples(sox_format_t *ft, const sox_sample_t *buf, size_t ns
   if (rc < 0)
   {
     lsx_fail_errno(ft, SOX_EPERM, "error writing to pulse audio device: %s", pa_strerror(error));
-    return SOX_EOF;
+    return 0;
   }
 
   return nsamp;
@@ -147,10 +424,27 @@ static size_t write_samples(sox_format_t *ft, const sox_sample_t *buf, size_t ns
 static int stopwrite(sox_format_t * ft)
 {
   priv_t *pa = (priv_t *)ft->priv;
+  pa_operation *o;
   int error;
 
-  pa_simple_drain(pa->pasp, &error);
-  pa_simple_free(pa->pasp);
+  if (pa->pasp) {
+    pa_simple_drain(pa->pasp, &error);
+    pa_simple_free(pa->pasp);
+    return SOX_SUCCESS;
+  }
+
+  pa_threaded_mainloop_lock(pa->mainloop);
+  if ((o = pa_stream_drain(pa->stream, stream_success_cb, pa))) {
+    while (pa_operation_get_state(o) == PA_OPERATION_RUNNING &&
+        stream_ok(ft))
+      pa_threaded_mainloop_wait(pa->mainloop);
+    pa_operation_unref(o);
+  }
+  ft->device.xruns = pa->xruns;
+  pa_threaded_mainloop_unlock(pa->mainloop);
+  if (ft->device.xruns)
+    lsx_report("%" PRIu64 " under/over-runs", ft->device.xruns);
+  stop_stream(pa);
 
   return SOX_SUCCESS;
 }
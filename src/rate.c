@@ -117,8 +117,17 @@ typedef struct stage {
   sox_bool   use_hi_prec_clock;
   int        L, remL, remM;
   int        n, phase_bits;
+
+  /* For an arb stage whose ratio may be changed while running: */
+  int64_t    step_target, glide_step;
+  size_t     glide;     /* Output samples until step reaches step_target */
 } stage_t;
 
+/* Moves a stage's step one output sample closer to its target: */
+#define glide_step(p) do if ((p)->glide) { \
+  (p)->step.all += (p)->glide_step; \
+  if (!--(p)->glide) (p)->step.all = (p)->step_target; } while (0)
+
 #define stage_occupancy(s) max(0, fifo_occupancy(&(s)->fifo) - (s)->pre_post)
 #define stage_read_p(s) ((sample_t *)fifo_read_ptr(&(s)->fifo) + (s)->pre)
 
@@ -134,6 +143,7 @@ static void cubic_stage_fn(stage_t * p, fifo_t * output_fifo)
     sample_t b = .5*(s[1]+s[-1])-*s, a = (1/6.)*(s[2]-s[1]+s[-1]-*s-4*b);
     sample_t c = s[1]-*s-a-b;
     output[i] = ((a*x + b)*x + c)*x + *s;
+    glide_step(p);
   }
   assert(max_num_out - i >= 0);
   fifo_trim_by(output_fifo, max_num_out - i);
@@ -255,13 +265,19 @@ typedef struct {
   uint64_t   samples_in, samples_out;
   int        num_stages;
   stage_t    * stages;
+
+  /* If the ratio may be changed while running: */
+  stage_t    * arb;           /* The stage whose step is changed */
+  double     factor0, step0;  /* The initial factor and arb stage step */
+  double     arb_out_mult;    /* Arb stage output samples per output sample */
+  double     samples_out_due; /* Accumulated over changes of factor */
 } rate_t;
 
 #define pre_stage       p->stages[shift]
 #define arb_stage       p->stages[shift + have_pre_stage]
 #define post_stage      p->stages[shift + have_pre_stage + have_arb_stage]
 #define have_pre_stage  (preM  * preL  != 1)
-#define have_arb_stage  (arbM  * arbL  != 1)
+#define have_arb_stage  (arbM  * arbL  != 1 || variable)
 #define have_post_stage (postM * postL != 1)
 
 #define TO_3dB(a)       ((1.6e-6*a-7.5e-4)*a+.646)
@@ -284,6 +300,7 @@ static void rate_init(
   double anti_aliasing_pc,   /* % bandwidth without aliasing            100   */
   rolloff_t rolloff,         /* Pass-band roll-off                    small   */
   sox_bool maintain_3dB_pt,  /*                                        true   */
+  sox_bool variable,         /* Allow factor to change; see rate_set_ratio.   */
                             
   /* Primarily for test/development purposes:                                 */
   sox_bool use_hi_prec_clock,/* Increase irrational ratio accuracy.   false   */
@@ -318,7 +335,8 @@ static void rate_init(
     preL = 1 + (!preM && arbM < 2) + (upsample && mode), arbM *= preL;
     if ((frac = arbM - (int)arbM))
       epsilon = fabs((uint32_t)(frac * MULT32 + .5) / (frac * MULT32) - 1);
-    for (i = 1, rational = !frac; i <= maxL && !rational; ++i) {
+    for (i = 1, rational = !frac && !variable; i <= maxL && !rational &&
+        !variable; ++i) {
       d = frac * i, try = d + .5;
       if ((rational = fabs(try / d - 1) <= epsilon)) {    /* No long doubles! */
         if (try == i)
@@ -431,7 +449,8 @@ static void rate_init(
     arb_stage.n = num_coefs4;
     arb_stage.phase_bits = phase_bits;
     arb_stage.L = arbL;
-    arb_stage.use_hi_prec_clock = mode > 1 && use_hi_prec_clock && !rational;
+    arb_stage.use_hi_prec_clock =
+      mode > 1 && use_hi_prec_clock && !rational && !variable;
     if (arb_stage.use_hi_prec_clock) {
       arb_stage.at.hi_prec_clock = at;
       arb_stage.step.hi_prec_clock = arbM;
@@ -443,6 +462,14 @@ static void rate_init(
     }
   }
 
+  if (variable) {
+    p->arb = &arb_stage;
+    p->factor0 = factor;
+    p->step0 = arbM * MULT32;
+    p->arb_out_mult = (double)postM / postL;
+    p->arb->step_target = p->arb->step.all;
+  }
+
   if (have_post_stage)
     dft_stage_init(1, 1 - (1 - (1 - tbw0) *
         (upsample? factor * postL / postM : 1)) * tbw_tighten, Fs_a,
@@ -466,9 +493,26 @@ static void rate_process(rate_t * p)
     stage->fn(stage, &(stage+1)->fifo);
 }
 
+/* Changes the ratio of a variable-ratio rate_t, gliding linearly to the
+ * new one over the given number of output samples. */
+static void rate_set_ratio(rate_t * p, double factor, size_t glide)
+{
+  stage_t * s = p->arb;
+  int64_t target = p->step0 * factor / p->factor0 + .5;
+
+  s->out_in_ratio = MULT32 * s->L / min(s->step.all, target);
+  s->step_target = target;
+  s->glide = glide * p->arb_out_mult;
+  if (s->glide)
+    s->glide_step = (target - s->step.all) / (int64_t)s->glide;
+  else s->step.all = target;
+  p->factor = factor;
+}
+
 static sample_t * rate_input(rate_t * p, sample_t const * samples, size_t n)
 {
   p->samples_in += n;
+  p->samples_out_due += n / p->factor;
   return fifo_write(&p->stages[0].fifo, (int)n, samples);
 }
 
@@ -482,7 +526,8 @@ static sample_t const * rate_output(rate_t * p, sample_t * samples, size_t * n)
 static void rate_flush(rate_t * p)
 {
   fifo_t * fifo = &p->stages[p->num_stages].fifo;
-  uint64_t samples_out = p->samples_in / p->factor + .5;
+  uint64_t samples_out = p->arb?
+    p->samples_out_due + .5 : p->samples_in / p->factor + .5;
   size_t remaining = samples_out > p->samples_out ?
       (size_t)(samples_out - p->samples_out) : 0;
   sample_t * buff = calloc(1024, sizeof(*buff));
@@ -494,6 +539,7 @@ static void rate_flush(rate_t * p)
     }
     fifo_trim_to(fifo, (int)remaining);
     p->samples_in = 0;
+    p->samples_out_due = 0;
   }
   free(buff);
 }
@@ -523,7 +569,7 @@ typedef struct {
   sox_rate_t      out_rate;
   int             rolloff, coef_interp, max_coefs_size;
   double          bit_depth, phase, bw_0dB_pc, anti_aliasing_pc;
-  sox_bool        use_hi_prec_clock, noIOpt, given_0dB_pt;
+  sox_bool        use_hi_prec_clock, noIOpt, given_0dB_pt, variable;
   rate_t          rate;
   rate_shared_t   shared, * shared_ptr;
 } priv_t;
@@ -533,7 +579,7 @@ static int create(sox_effect_t * effp, int argc, char **argv)
   priv_t * p = (priv_t *) effp->priv;
   int c, quality;
   char * dummy_p, * found_at;
-  char const * opts = "+i:c:b:B:A:p:Q:R:d:MILafnost" "qlmghevu";
+  char const * opts = "+i:c:b:B:A:p:Q:R:d:MILafnostV" "qlmghevu";
   char const * qopts = strchr(opts, 'q');
   double rej = 0, bw_3dB_pc = 0;
   sox_bool allow_aliasing = sox_false;
@@ -564,6 +610,7 @@ static int create(sox_effect_t * effp, int argc, char **argv)
     case 'n': p->noIOpt = sox_true; break;
     case 's': bw_3dB_pc = 99; break;
     case 't': p->use_hi_prec_clock = sox_true; break;
+    case 'V': p->variable = sox_true; break;
     default:
       if ((found_at = strchr(qopts, c)))
         quality = found_at - qopts;
@@ -630,7 +677,7 @@ static int start(sox_effect_t * effp)
   priv_t * p = (priv_t *) effp->priv;
   double out_rate = p->out_rate != 0 ? p->out_rate : effp->out_signal.rate;
 
-  if (effp->in_signal.rate == out_rate)
+  if (effp->in_signal.rate == out_rate && !p->variable)
     return SOX_EFF_NULL;
 
   if (effp->in_signal.mult)
@@ -640,7 +687,8 @@ static int start(sox_effect_t * effp)
   effp->out_signal.rate = out_rate;
   rate_init(&p->rate, p->shared_ptr, effp->in_signal.rate/out_rate,p->bit_depth,
       p->phase, p->bw_0dB_pc, p->anti_aliasing_pc, p->rolloff, !p->given_0dB_pt,
-      p->use_hi_prec_clock, p->coef_interp, p->max_coefs_size, p->noIOpt);
+      p->variable, p->use_hi_prec_clock, p->coef_interp, p->max_coefs_size,
+      p->noIOpt);
 
   if (!p->rate.num_stages) {
     lsx_warn("input and output rates too close, skipping resampling");
@@ -684,13 +732,33 @@ static int stop(sox_effect_t * effp)
   return SOX_SUCCESS;
 }
 
+/* The ratio may be changed only a little, as the filters are designed
+ * for the initial one. */
+#define MAX_RATIO_CHANGE .05
+
+int sox_rate_set_ratio(sox_effect_t * effp, double factor, size_t glide)
+{
+  priv_t * p = (priv_t *)effp->priv;
+  size_t f;
+
+  if (effp->handler.start != start || !p->rate.arb)
+    return SOX_EOF;
+  if (fabs(factor / p->rate.factor0 - 1) > MAX_RATIO_CHANGE) {
+    lsx_fail("can't change the ratio by more than %g%%", MAX_RATIO_CHANGE * 100);
+    return SOX_EOF;
+  }
+  for (f = 0; f < effp->flows; ++f)
+    rate_set_ratio(&((priv_t *)effp[f].priv)->rate, factor, glide);
+  return SOX_SUCCESS;
+}
+
 sox_effect_handler_t const * lsx_rate_effect_fn(void)
 {
   static sox_effect_handler_t handler = {
     "rate", 0, SOX_EFF_RATE, create, start, flow, drain, stop, 0, sizeof(priv_t)
   };
   static char const * lines[] = {
-    "[-q|-l|-m|-h|-v] [override-options] RATE[k]",
+    "[-q|-l|-m|-h|-v] [-V] [override-options] RATE[k]",
     "                    BAND-",
     "     QUALITY        WIDTH  REJ dB   TYPICAL USE",
     " -q  quick          n/a  ~30 @ Fs/4 playback on ancient hardware",
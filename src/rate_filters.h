@@ -103,7 +103,6 @@ static struct {int num_coefs; stage_fn_t fn; float att;} const half_firs[] = {
 
 #define FUNCTION vpoly0
 #define FIR_LENGTH VAR_LENGTH
-#define CONVOLVE VAR_CONVOLVE
 #include "rate_poly_fir0.h"
 
 #define FUNCTION vpoly1
@@ -130,17 +129,14 @@ static struct {int num_coefs; stage_fn_t fn; float att;} const half_firs[] = {
 #undef HI_PREC_CLOCK
 
 #define U100_l 42
-#define poly_fir_convolve_U100 _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
 #define FUNCTION U100_0
 #define FIR_LENGTH U100_l
-#define CONVOLVE poly_fir_convolve_U100
 #include "rate_poly_fir0.h"
 
 #define u100_l 11
 #define poly_fir_convolve_u100 _ _ _ _ _ _ _ _ _ _ _
 #define FUNCTION u100_0
 #define FIR_LENGTH u100_l
-#define CONVOLVE poly_fir_convolve_u100
 #include "rate_poly_fir0.h"
 
 #define FUNCTION u100_1
@@ -71,6 +71,7 @@ static void FUNCTION(stage_t * p, fifo_t * output_fifo)
       int j = 0;
       CONVOLVE
       output[i] = sum;
+      glide_step(p);
     }
     fifo_read(&p->fifo, p->at.parts.integer, NULL);
     p->at.parts.integer = 0;
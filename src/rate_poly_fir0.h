@@ -16,33 +16,39 @@
  */
 
 /* Resample using a non-interpolated poly-phase FIR with length LEN.*/
-/* Input must be followed by LEN-1 samples. */
-
-#define _ sum += (coef(p->shared->poly_fir_coefs, 0, FIR_LENGTH, divided.rem, 0, j)) *at[j], ++j;
+/* Input must be followed by LEN-1 samples.  The phase's coefs are */
+/* contiguous, and the clock is integer (L and step are exact).    */
 
 static void FUNCTION(stage_t * p, fifo_t * output_fifo)
 {
   sample_t const * input = stage_read_p(p);
   int i, num_in = stage_occupancy(p), max_num_out = 1 + num_in*p->out_in_ratio;
   sample_t * output = fifo_reserve(output_fifo, max_num_out);
-  div_t divided2;
+  div_t divided = div(p->at.parts.integer, p->L); /* Input sample & phase */
+  div_t const step = div(p->step.parts.integer, p->L);
 
-  for (i = 0; p->at.parts.integer < num_in * p->L; ++i, p->at.parts.integer += p->step.parts.integer) {
-    div_t divided = div(p->at.parts.integer, p->L);
+  for (i = 0; divided.quot < num_in; ++i) {
     sample_t const * at = input + divided.quot;
-    sample_t sum = 0;
-    int j = 0;
-    CONVOLVE
-    output[i] = sum;
+    sample_t const * c =
+      &coef(p->shared->poly_fir_coefs, 0, FIR_LENGTH, divided.rem, 0, 0);
+    sample_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0; /* Independent, so */
+    int j;                                  /* may be computed in parallel */
+    for (j = 0; j + 4 <= FIR_LENGTH; j += 4) {
+      sum0 += c[j] * at[j], sum1 += c[j+1] * at[j+1];
+      sum2 += c[j+2] * at[j+2], sum3 += c[j+3] * at[j+3];
+    }
+    for (; j < FIR_LENGTH; ++j)
+      sum0 += c[j] * at[j];
+    output[i] = (sum0 + sum1) + (sum2 + sum3);
+    divided.quot += step.quot, divided.rem += step.rem;
+    if (divided.rem >= p->L)
+      divided.rem -= p->L, ++divided.quot;
   }
   assert(max_num_out - i >= 0);
   fifo_trim_by(output_fifo, max_num_out - i);
-  divided2 = div(p->at.parts.integer, p->L);
-  fifo_read(&p->fifo, divided2.quot, NULL);
-  p->at.parts.integer = divided2.rem;
+  fifo_read(&p->fifo, divided.quot, NULL);
+  p->at.parts.integer = divided.rem;
 }
 
-#undef _
-#undef CONVOLVE
 #undef FIR_LENGTH
 #undef FUNCTION
@@ -194,3 +194,75 @@ size_t lsx_rawwrite(
     return write_buf(ft, buf, nsamp);
   return 0;
 }
+
+/* The 8-bit encodings that lsx_rawread and lsx_rawwrite handle */
+static sox_bool is_raw8(sox_format_t const * ft)
+{
+  if (ft->encoding.bits_per_sample != 8)
+    return sox_false;
+  switch (ft->encoding.encoding) {
+    case SOX_ENCODING_SIGN2: case SOX_ENCODING_UNSIGNED:
+    case SOX_ENCODING_ULAW: case SOX_ENCODING_ALAW: return sox_true;
+    default: return sox_false;
+  }
+}
+
+/* Fills map[] with the code that each 8-bit input code becomes when
+ * converted to sox_sample_t and back, as lsx_rawread and lsx_rawwrite
+ * would do.  Returns the number of codes that would clip. */
+static size_t raw8_map(sox_format_t const * ift, sox_format_t const * oft,
+    uint8_t * map)
+{
+  SOX_SAMPLE_LOCALS;
+  size_t clips = 0;
+  int i;
+
+  LSX_USE_VAR(sox_macro_temp_sample), LSX_USE_VAR(sox_macro_temp_double);
+  for (i = 0; i < 256; ++i) {
+    sox_sample_t d;
+    switch (ift->encoding.encoding) {
+      case SOX_ENCODING_SIGN2: d = SOX_SIGNED_8BIT_TO_SAMPLE((int8_t)i,); break;
+      case SOX_ENCODING_UNSIGNED: d = SOX_UNSIGNED_8BIT_TO_SAMPLE(i,); break;
+      case SOX_ENCODING_ULAW: d = SOX_ULAW_BYTE_TO_SAMPLE(i,); break;
+      default: d = SOX_ALAW_BYTE_TO_SAMPLE(i,); break;
+    }
+    switch (oft->encoding.encoding) {
+      case SOX_ENCODING_SIGN2: map[i] = (int8_t)SOX_SAMPLE_TO_SIGNED_8BIT(d, clips); break;
+      case SOX_ENCODING_UNSIGNED: map[i] = SOX_SAMPLE_TO_UNSIGNED_8BIT(d, clips); break;
+      case SOX_ENCODING_ULAW: map[i] = SOX_SAMPLE_TO_ULAW_BYTE(d, clips); break;
+      default: map[i] = SOX_SAMPLE_TO_ALAW_BYTE(d, clips); break;
+    }
+  }
+  return clips;
+}
+
+/* True if samples can be copied from ift to oft with lsx_rawtranscode,
+ * i.e. both are 8-bit raw encodings and no code would clip. */
+sox_bool lsx_rawcantranscode(sox_format_t const * ift, sox_format_t const * oft)
+{
+  uint8_t map[256];
+
+  return (ift->handler.read == lsx_rawread || (ift->handler.flags & SOX_FILE_RAW_DATA)) &&
+    (oft->handler.write == lsx_rawwrite || (oft->handler.flags & SOX_FILE_RAW_DATA)) &&
+    ift->signal.channels == oft->signal.channels &&
+    ift->signal.rate == oft->signal.rate &&
+    is_raw8(ift) && is_raw8(oft) && !raw8_map(ift, oft, map);
+}
+
+/* Copies up to nsamp samples from ift to oft through a 256-entry code map,
+ * rather than converting to and from sox_sample_t; e.g. u-law <-> A-law.
+ * Works through a block on the stack, so nothing is allocated per call. */
+size_t lsx_rawtranscode(sox_format_t * ift, sox_format_t * oft, size_t nsamp)
+{
+  uint8_t map[256], data[4096];
+  size_t n, nread, nwritten, done = 0;
+
+  raw8_map(ift, oft, map);
+  do {
+    nread = lsx_read_b_buf(ift, data, min(nsamp - done, sizeof(data)));
+    for (n = 0; n < nread; n++)
+      data[n] = map[data[n]];
+    done += nwritten = lsx_write_b_buf(oft, data, nread);
+  } while (nread == sizeof(data) && nwritten == nread && done < nsamp);
+  return done;
+}
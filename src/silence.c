@@ -15,6 +15,7 @@
 
 #include "sox_i.h"
 
+#include <ctype.h>
 #include <string.h>
 
 /* Private data for silence effect. */
@@ -56,13 +57,36 @@ typedef struct {
     double      *window_end;
     size_t   window_size;
     double      rms_sum;
+    double      start_limit, stop_limit; /* Thresholds, as rms_sum values */
 
     char        leave_silence;
+    char        analyse;      /* Report the silence found; output no audio */
 
     /* State Machine */
     char        mode;
+
+    /* Kept segments of the input, as start, end pairs of wide samples: */
+    uint64_t    consumed;        /* Non-wide samples of input before ibuf */
+    uint64_t    *segments;
+    size_t      num_boundaries;
+    sox_bool    reported;
 } priv_t;
 
+/* With -j, each removed (silent) part of the input is written as a line of
+ * JSON as soon as it is known: */
+static void report(sox_effect_t * effp, uint64_t start, uint64_t const * end)
+{
+    double rate = effp->in_signal.rate;
+
+    if (end && *end <= start)
+        return;
+    printf("{\"silence_start\":%.6f,\"silence_end\":", start / rate);
+    if (end)
+        printf("%.6f}\n", *end / rate);
+    else printf("null}\n");
+    fflush(stdout);
+}
+
 static void clear_rms(sox_effect_t * effp)
 
 {
@@ -76,6 +100,23 @@ static void clear_rms(sox_effect_t * effp)
     silence->rms_sum = 0;
 }
 
+/* Records the start or (alternately) the end of a kept segment, at the given
+ * input position in non-wide samples. */
+static void boundary(sox_effect_t * effp, uint64_t position)
+{
+    priv_t * silence = (priv_t *) effp->priv;
+
+    if ((silence->num_boundaries & 31) == 0)
+        lsx_revalloc(silence->segments, silence->num_boundaries + 32);
+    silence->segments[silence->num_boundaries] =
+        position / effp->in_signal.channels;
+    if (silence->analyse && !(silence->num_boundaries & 1))
+        report(effp, silence->num_boundaries?
+            silence->segments[silence->num_boundaries - 1] : 0,
+            &silence->segments[silence->num_boundaries]);
+    ++silence->num_boundaries;
+}
+
 static int sox_silence_getopts(sox_effect_t * effp, int argc, char **argv)
 {
     priv_t *   silence = (priv_t *) effp->priv;
@@ -86,12 +127,23 @@ static int sox_silence_getopts(sox_effect_t * effp, int argc, char **argv)
 
     /* check for option switches */
     silence->leave_silence = sox_false;
-    if (argc > 0)
+    silence->analyse = sox_false;
+    for (; argc > 0 && **argv == '-' && !isdigit((unsigned char)argv[0][1]); argc--, argv++)
     {
-        if (!strcmp("-l", *argv)) {
-            argc--; argv++;
+        if (!strcmp("-l", *argv))
             silence->leave_silence = sox_true;
+        else if (!strcmp("-j", *argv))
+            silence->analyse = sox_true;
+        else
+            return lsx_usage(effp);
+    }
+    if (silence->analyse) {
+        if (effp->global_info->global_info->stdout_in_use_by) {
+            lsx_fail("stdout already in use by `%s'",
+                     effp->global_info->global_info->stdout_in_use_by);
+            return SOX_EOF;
         }
+        effp->global_info->global_info->stdout_in_use_by = effp->handler.name;
     }
 
     if (argc < 1)
@@ -221,6 +273,30 @@ static int sox_silence_getopts(sox_effect_t * effp, int argc, char **argv)
     return(SOX_SUCCESS);
 }
 
+/* Converts a threshold to the smallest window sum of squares whose RMS is
+ * above it, so that testing a sample needs no square root, scaling or
+ * logarithm.  When scaling low bit data, noise values got scaled way up,
+ * so only the original bits of the RMS are considered. */
+static double rms_sum_limit(sox_effect_t const * effp, double threshold, int unit)
+{
+  priv_t const * silence = (priv_t const *) effp->priv;
+  double q = ldexp(1., 32 - (int)effp->in_signal.precision); /* RMS quantum */
+  double t = unit == 'd'? dB_to_linear(threshold) :
+      unit == '%'? threshold / 100 : threshold;
+  double rms = (floor(t * SOX_SAMPLE_MAX / q) + 1) * q;
+
+  return rms * rms * silence->window_size;
+}
+
+/* Whether the RMS over the window, with sample in place of the oldest
+ * value in it, is above the threshold given by limit. */
+static sox_bool aboveThreshold(priv_t const * silence, sox_sample_t sample,
+    double limit)
+{
+  return silence->rms_sum - *silence->window_current +
+      (double)sample * (double)sample >= limit;
+}
+
 static int sox_silence_start(sox_effect_t * effp)
 {
     priv_t *silence = (priv_t *)effp->priv;
@@ -252,10 +328,20 @@ static int sox_silence_start(sox_effect_t * effp)
         silence->stop_duration = temp * effp->in_signal.channels;
     }
 
+    silence->start_limit = rms_sum_limit(effp,  /* Also used on restart */
+        silence->start_threshold, silence->start_unit);
+    silence->stop_limit = rms_sum_limit(effp,
+        silence->stop_threshold, silence->stop_unit);
+
+    silence->consumed = 0;
+    silence->num_boundaries = 0;
+    silence->reported = sox_false;
     if (silence->start)
         silence->mode = SILENCE_TRIM;
-    else
+    else {
         silence->mode = SILENCE_COPY;
+        boundary(effp, 0);
+    }
 
     silence->start_holdoff = lsx_malloc(sizeof(sox_sample_t)*silence->start_duration);
     silence->start_holdoff_offset = 0;
@@ -272,38 +358,6 @@ static int sox_silence_start(sox_effect_t * effp)
     return(SOX_SUCCESS);
 }
 
-static sox_bool aboveThreshold(sox_effect_t const * effp,
-    sox_sample_t value /* >= 0 */, double threshold, int unit)
-{
-  /* When scaling low bit data, noise values got scaled way up */
-  /* Only consider the original bits when looking for silence */
-  sox_sample_t masked_value = value & (-1 << (32 - effp->in_signal.precision));
-
-  double scaled_value = (double)masked_value / SOX_SAMPLE_MAX;
-
-  if (unit == '%')
-    scaled_value *= 100;
-  else if (unit == 'd')
-    scaled_value = linear_to_dB(scaled_value);
-
-  return scaled_value > threshold;
-}
-
-static sox_sample_t compute_rms(sox_effect_t * effp, sox_sample_t sample)
-{
-    priv_t * silence = (priv_t *) effp->priv;
-    double new_sum;
-    sox_sample_t rms;
-
-    new_sum = silence->rms_sum;
-    new_sum -= *silence->window_current;
-    new_sum += ((double)sample * (double)sample);
-
-    rms = sqrt(new_sum / silence->window_size);
-
-    return (rms);
-}
-
 static void update_rms(sox_effect_t * effp, sox_sample_t sample)
 {
     priv_t * silence = (priv_t *) effp->priv;
@@ -319,7 +373,7 @@ static void update_rms(sox_effect_t * effp, sox_sample_t sample)
 
 /* Process signed long samples from ibuf to obuf. */
 /* Return number of samples processed in isamp and osamp. */
-static int sox_silence_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
+static int silence_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
                     size_t *isamp, size_t *osamp)
 {
     priv_t * silence = (priv_t *) effp->priv;
@@ -350,10 +404,8 @@ silence_trim:
                 threshold = 0;
                 for (j = 0; j < effp->in_signal.channels; j++)
                 {
-                    threshold |= aboveThreshold(effp,
-                                                compute_rms(effp, ibuf[j]),
-                                                silence->start_threshold,
-                                                silence->start_unit);
+                    threshold |= aboveThreshold(silence, ibuf[j],
+                                                silence->start_limit);
                 }
 
                 if (threshold)
@@ -373,6 +425,8 @@ silence_trim:
                         if (++silence->start_found_periods >=
                                 silence->start_periods)
                         {
+                            boundary(effp, silence->consumed +
+                                nrOfInSamplesRead - silence->start_holdoff_end);
                             silence->mode = SILENCE_TRIM_FLUSH;
                             goto silence_trim_flush;
                         }
@@ -471,10 +525,8 @@ silence_copy:
                     threshold = 1;
                     for (j = 0; j < effp->in_signal.channels; j++)
                     {
-                        threshold &= aboveThreshold(effp,
-                                                    compute_rms(effp, ibuf[j]),
-                                                    silence->stop_threshold,
-                                                    silence->stop_unit);
+                        threshold &= aboveThreshold(silence, ibuf[j],
+                                                    silence->stop_limit);
                     }
 
                     /* Case 1a
@@ -533,12 +585,16 @@ silence_copy:
                             if (++silence->stop_found_periods >=
                                     silence->stop_periods)
                             {
+                                boundary(effp, silence->consumed +
+                                    nrOfInSamplesRead - (silence->leave_silence?
+                                    0 : silence->stop_holdoff_end));
                                 silence->stop_holdoff_offset = 0;
                                 silence->stop_holdoff_end = 0;
                                 if (!silence->restart)
                                 {
                                     *isamp = nrOfInSamplesRead;
                                     *osamp = nrOfOutSamplesWritten;
+                                    silence->consumed += nrOfInSamplesRead;
                                     silence->mode = SILENCE_STOP;
                                     /* Return SOX_EOF since no more processing */
                                     return (SOX_EOF);
@@ -610,16 +666,54 @@ silence_copy_flush:
 
         *isamp = nrOfInSamplesRead;
         *osamp = nrOfOutSamplesWritten;
+        silence->consumed += nrOfInSamplesRead;
 
         return (SOX_SUCCESS);
 }
 
+static int sox_silence_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
+                    size_t *isamp, size_t *osamp)
+{
+    priv_t * silence = (priv_t *) effp->priv;
+    size_t idone = 0, ilen, olen;
+    int result;
+
+    if (!silence->analyse)
+        return silence_flow(effp, ibuf, obuf, isamp, osamp);
+
+    /* Use obuf as scratch, so that all of the input can be consumed: */
+    do {
+        ilen = *isamp - idone, olen = *osamp;
+        result = silence_flow(effp, ibuf + idone, obuf, &ilen, &olen);
+        idone += ilen;
+    } while (result == SOX_SUCCESS && idone < *isamp && (ilen || olen));
+    *isamp = idone, *osamp = 0;
+    if (result == SOX_EOF) {  /* The rest of the input would be removed */
+        report(effp, silence->segments[silence->num_boundaries - 1], NULL);
+        silence->reported = sox_true;
+    }
+    return result;
+}
+
 static int sox_silence_drain(sox_effect_t * effp, sox_sample_t *obuf, size_t *osamp)
 {
     priv_t * silence = (priv_t *) effp->priv;
     size_t i;
     size_t nrOfTicks, nrOfOutSamplesWritten = 0; /* non-wide samples */
 
+    if (silence->num_boundaries & 1)  /* A kept segment runs to the end */
+        boundary(effp, silence->consumed);
+    if (silence->analyse) {
+        if (!silence->reported) {
+            uint64_t end = silence->consumed / effp->in_signal.channels;
+            report(effp, silence->num_boundaries?
+                silence->segments[silence->num_boundaries - 1] : 0, &end);
+            silence->reported = sox_true;
+        }
+        *osamp = 0;
+        return SOX_EOF;
+    }
+
     /* Only if in flush mode will there be possible samples to write
      * out during drain() call.
      */
@@ -656,6 +750,8 @@ static int sox_silence_stop(sox_effect_t * effp)
   priv_t * silence = (priv_t *) effp->priv;
 
   free(silence->window);
+  free(silence->segments);
+  silence->segments = NULL;
   free(silence->start_holdoff);
   free(silence->stop_holdoff);
 
@@ -674,7 +770,7 @@ static int lsx_kill(sox_effect_t * effp)
 
 static sox_effect_handler_t sox_silence_effect = {
   "silence",
-  "[ -l ] above_periods [ duration threshold[d|%] ] [ below_periods duration threshold[d|%] ]",
+  "[ -l ] [ -j ] above_periods [ duration threshold[d|%] ] [ below_periods duration threshold[d|%] ]",
   SOX_EFF_MCHAN | SOX_EFF_MODIFY | SOX_EFF_LENGTH,
   sox_silence_getopts,
   sox_silence_start,
@@ -684,6 +780,17 @@ static sox_effect_handler_t sox_silence_effect = {
   lsx_kill, sizeof(priv_t)
 };
 
+/* Lets a libSoX client (e.g. sox --split) cut the kept parts from the
+ * input itself, rather than have them run together in the output. */
+size_t sox_silence_get_segments(sox_effect_t const * effp,
+    sox_uint64_t const * * segments)
+{
+    priv_t const * silence = (priv_t const *) effp->priv;
+
+    *segments = silence->segments;
+    return silence->num_boundaries / 2;
+}
+
 const sox_effect_handler_t *lsx_silence_effect_fn(void)
 {
     return &sox_silence_effect;
@@ -0,0 +1,261 @@
+/* libSoX simulated audio device   (c) 2014 SoX contributors
+ *
+ * Paces reads (silence) and writes (discarded) against a virtual device
+ * clock, as a real audio device would, so that real-time behaviour can be
+ * measured without sound hardware.  The device name is `default' or a
+ * list of options separated by colons:
+ *
+ *   period=FRAMES   Frames per period (default --device-period, else 1024)
+ *   buffer=FRAMES   Device buffer size (default --device-buffer, else 4
+ *                   periods); rounded down to a whole number of periods
+ *   jitter=MS       Each period is made ready (capture) or due (playback)
+ *                   at a random time within +/- this many milliseconds
+ *   drift=PPM       The device clock runs fast (+) or slow (-) by this
+ *                   many parts per million relative to the system clock
+ *   log=FILE        Write each period's number and deadline margin (in
+ *                   seconds; negative if missed) to FILE
+ *
+ * The deadline margin of a playback period is the time between its being
+ * completely written and the device needing it; of a capture period, the
+ * time between the application starting to read it and the device
+ * overwriting it.  A missed deadline is counted as an xrun, and the device
+ * clock restarted from the late period, as alsa would.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "sox_i.h"
+
+#if defined HAVE_CLOCK_GETTIME && defined HAVE_NANOSLEEP
+
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  size_t       period, periods;     /* Period size (frames); periods per buffer */
+  double       jitter, drift;       /* Seconds; parts per million */
+  FILE         * log;
+  double       t0, T;               /* Device clock start; period duration */
+  double       offset;              /* Jitter of the current period */
+  sox_bool     started;
+  sox_uint64_t frames;              /* Frames transferred */
+  double       margin_min, margin_max, margin_sum;
+  sox_uint64_t margins;
+} priv_t;
+
+static double now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void sleep_until(double t)
+{
+  double dt = t - now();
+  struct timespec ts;
+
+  if (dt > 0) {
+    ts.tv_sec = (time_t)dt;
+    ts.tv_nsec = (long)((dt - ts.tv_sec) * 1e9);
+    while (nanosleep(&ts, &ts) && errno == EINTR);
+  }
+}
+
+static int start(sox_format_t * ft)
+{
+  priv_t * p = (priv_t *)ft->priv;
+  char * opts = lsx_strdup(ft->filename), * opt, * log_name = NULL;
+  size_t buffer = sox_globals.device_buffer;
+  double d;
+  char dummy;
+
+  p->period = sox_globals.device_period? sox_globals.device_period : 1024;
+  for (opt = strtok(opts, ":"); opt; opt = strtok(NULL, ":")) {
+    if (!strcmp(opt, "default"))
+      continue;
+    if (!strncmp(opt, "log=", (size_t)4) && opt[4])
+      log_name = lsx_strdup(opt + 4);
+    else if (sscanf(opt, "period=%lf %c", &d, &dummy) == 1 && d >= 1)
+      p->period = d;
+    else if (sscanf(opt, "buffer=%lf %c", &d, &dummy) == 1 && d >= 1)
+      buffer = d;
+    else if (sscanf(opt, "jitter=%lf %c", &d, &dummy) == 1 && d >= 0)
+      p->jitter = d * 1e-3;
+    else if (sscanf(opt, "drift=%lf %c", &d, &dummy) == 1 && d > -1e6)
+      p->drift = d;
+    else {
+      lsx_fail_errno(ft, SOX_EINVAL, "invalid option `%s'", opt);
+      free(opts);
+      return SOX_EOF;
+    }
+  }
+  free(opts);
+
+  p->periods = max((buffer? buffer : 4 * p->period) / p->period, 2);
+  p->T = p->period / (ft->signal.rate * (1 + p->drift * 1e-6));
+  p->margin_min = HUGE_VAL, p->margin_max = -HUGE_VAL;
+  ft->device.buffer_size = p->periods * p->period;
+  ft->device.fill_min = ft->mode == 'r'? ft->device.buffer_size : 0;
+  if (log_name) {
+    p->log = fopen(log_name, "w");
+    if (!p->log)
+      lsx_fail_errno(ft, errno, "can't create log file `%s'", log_name);
+    free(log_name);
+    if (!p->log)
+      return SOX_EOF;
+  }
+  lsx_report("buffer %lu frames, period %lu frames (%g ms)",
+      (unsigned long)ft->device.buffer_size, (unsigned long)p->period, p->T * 1e3);
+  return SOX_SUCCESS;
+}
+
+/* Records the deadline margin of period k. */
+static void period_done(sox_format_t * ft, sox_uint64_t k, double deadline)
+{
+  priv_t * p = (priv_t *)ft->priv;
+  double margin = deadline - now();
+
+  p->margin_min = min(p->margin_min, margin);
+  p->margin_max = max(p->margin_max, margin);
+  p->margin_sum += margin;
+  if (p->log)
+    fprintf(p->log, "%" PRIu64 " %.6f\n", k, margin);
+  ++p->margins;
+  if (margin < 0) {
+    lsx_warn("%s-run", ft->mode == 'r'? "over" : "under");
+    ++ft->device.xruns;
+    ft->device.xrun_time -= margin;
+    p->t0 -= margin;
+  }
+}
+
+/* Starts a new period, choosing when the device will be ready for it. */
+static double next_period(priv_t * p)
+{
+  p->offset = p->jitter * DRANQD1;
+  return p->t0 + (double)(p->frames / p->period) * p->T + p->offset;
+}
+
+static void update_fill(sox_format_t * ft)
+{
+  priv_t * p = (priv_t *)ft->priv;
+  sox_device_stats_t * d = &ft->device;
+  double elapsed = p->started? floor((now() - p->t0) / p->T) : 0;
+  sox_uint64_t device = max(elapsed, 0) * p->period;  /* Captured or played */
+
+  d->fill = ft->mode == 'r'? device - min(device, p->frames) :
+    p->frames - min(device, p->frames);
+  d->fill = min(d->fill, d->buffer_size);
+  d->fill_min = min(d->fill_min, d->fill);
+  d->fill_max = max(d->fill_max, d->fill);
+}
+
+static int startread(sox_format_t * ft)
+{
+  if (!ft->encoding.encoding) {
+    ft->encoding.encoding = SOX_ENCODING_SIGN2;
+    ft->encoding.bits_per_sample = 16;
+  }
+  ft->signal.precision = ft->encoding.bits_per_sample?
+      ft->encoding.bits_per_sample: SOX_SAMPLE_PRECISION;
+  return start(ft);
+}
+
+static size_t read_samples(sox_format_t * ft, sox_sample_t * buf, size_t len)
+{
+  priv_t * p = (priv_t *)ft->priv;
+  size_t frames = len / ft->signal.channels, done = 0, n;
+
+  if (!p->started)
+    p->t0 = now(), p->started = sox_true;
+  while (done < frames) {
+    if (p->frames % p->period == 0) {
+      double ready = next_period(p) + p->T;
+      sleep_until(ready);
+      period_done(ft, p->frames / p->period, ready + (p->periods - 1) * p->T);
+    }
+    n = min(frames - done, p->period - p->frames % p->period);
+    p->frames += n;
+    done += n;
+  }
+  memset(buf, 0, sizeof(*buf) * done * ft->signal.channels);
+  update_fill(ft);
+  return done * ft->signal.channels;
+}
+
+static size_t write_samples(
+    sox_format_t * ft, sox_sample_t const * buf, size_t len)
+{
+  priv_t * p = (priv_t *)ft->priv;
+  size_t frames = len / ft->signal.channels, done = 0, n;
+  sox_uint64_t k;
+  (void)buf;
+
+  while (done < frames) {
+    k = p->frames / p->period;
+    if (p->frames % p->period == 0 && p->started) {
+      /* Wait for room in the buffer: */
+      sleep_until(p->t0 + (double)(k - p->periods + 1) * p->T);
+      next_period(p);
+    }
+    n = min(frames - done, p->period - p->frames % p->period);
+    p->frames += n;
+    done += n;
+    if (p->frames % p->period)
+      continue;
+    if (p->started)
+      period_done(ft, k, p->t0 + (double)k * p->T + p->offset);
+    else if (k + 1 == p->periods)       /* The device starts when full */
+      p->t0 = now(), p->started = sox_true;
+  }
+  update_fill(ft);
+  return done * ft->signal.channels;
+}
+
+static int stop(sox_format_t * ft)
+{
+  priv_t * p = (priv_t *)ft->priv;
+
+  if (ft->mode == 'w') {  /* Drain */
+    if (!p->started)
+      p->t0 = now(), p->started = sox_true;
+    sleep_until(p->t0 + (double)p->frames / p->period * p->T);
+  }
+  if (p->margins)
+    lsx_report("%" PRIu64 " periods; deadline margin min %g ms, mean %g ms, "
+        "max %g ms; %" PRIu64 " missed", p->margins, p->margin_min * 1e3,
+        p->margin_sum / p->margins * 1e3, p->margin_max * 1e3, ft->device.xruns);
+  if (p->log && fclose(p->log)) {
+    lsx_fail_errno(ft, errno, "error writing log file");
+    return SOX_EOF;
+  }
+  return SOX_SUCCESS;
+}
+
+LSX_FORMAT_HANDLER(simdev)
+{
+  static char const * const names[] = {"simdev", NULL};
+  static sox_format_handler_t const handler = {SOX_LIB_VERSION_CODE,
+    "Simulated audio device, for measuring real-time performance",
+    names, SOX_FILE_DEVICE | SOX_FILE_NOSTDIO,
+    startread, read_samples, stop,
+    start, write_samples, stop,
+    NULL, NULL, NULL, sizeof(priv_t)
+  };
+  return &handler;
+}
+
+#endif
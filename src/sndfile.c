@@ -482,8 +482,8 @@ static int stopwrite(sox_format_t * ft)
 static int seek(sox_format_t * ft, uint64_t offset)
 {
   priv_t * sf = (priv_t *)ft->priv;
-  sf->sf_seek(sf->sf_file, (sf_count_t)(offset / ft->signal.channels), SEEK_CUR);
-  return SOX_SUCCESS;
+  return sf->sf_seek(sf->sf_file, (sf_count_t)(offset / ft->signal.channels),
+      SEEK_SET) < 0? SOX_EOF : SOX_SUCCESS;
 }
 
 LSX_FORMAT_HANDLER(sndfile)
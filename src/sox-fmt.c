@@ -17,10 +17,45 @@
 
 #include "sox_i.h"
 #include <string.h>
+#ifdef HAVE_SYS_MMAN_H
+  #include <sys/mman.h>
+#endif
 
 static char const magic[2][4] = {".SoX", "XoS."};
 #define FIXED_HDR     (4 + 8 + 8 + 4 + 4) /* Without magic */
 
+/* Samples are stored as sox_sample_t, so, unless the file is opposite
+ * endian, they are read and written directly to and from the caller's
+ * buffer.  A seekable input file (e.g. on /dev/shm) is mapped into memory
+ * and its samples copied straight out of the mapping. */
+typedef struct {
+  char   * map;       /* Mapped input file, or NULL */
+  size_t   map_len;
+  size_t   pos;       /* Read position (bytes) within map */
+} priv_t;
+
+static void map_input(sox_format_t * ft)
+{
+#ifdef HAVE_SYS_MMAN_H
+  priv_t * p = (priv_t *)ft->priv;
+  uint64_t len = lsx_filelength(ft);
+  void * map;
+
+  if (!ft->seekable || ft->io_type != lsx_io_file ||
+      ft->encoding.reverse_bytes || len <= ft->data_start || len > (size_t)-1)
+    return;
+  map = mmap(NULL, (size_t)len, PROT_READ, MAP_SHARED, fileno((FILE*)ft->fp), (off_t)0);
+  if (map == MAP_FAILED)
+    return;
+  p->map = map;
+  p->map_len = len;
+  p->pos = ft->data_start;
+  lsx_debug("mapped %" PRIu64 " bytes", len);
+#else
+  (void)ft;
+#endif
+}
+
 static int startread(sox_format_t * ft)
 {
   char     magic_[sizeof(magic[0])];
@@ -69,8 +104,50 @@ static int startread(sox_format_t * ft)
    * and further header information that might be defined in future. */
   lsx_seeki(ft, (off_t)(headers_bytes - FIXED_HDR - comments_bytes), SEEK_CUR);
 
-  return lsx_check_read_params(
-      ft, num_channels, rate, SOX_ENCODING_SIGN2, 32, num_samples, sox_true);
+  if (lsx_check_read_params(
+      ft, num_channels, rate, SOX_ENCODING_SIGN2, 32, num_samples, sox_true))
+    return SOX_EOF;
+  map_input(ft);
+  return SOX_SUCCESS;
+}
+
+static size_t read_samples(sox_format_t * ft, sox_sample_t * buf, size_t len)
+{
+  priv_t * p = (priv_t *)ft->priv;
+
+  if (p->map) {
+    len = min(len, (p->map_len - p->pos) / sizeof(*buf));
+    memcpy(buf, p->map + p->pos, len * sizeof(*buf));
+    p->pos += len * sizeof(*buf);
+    return len;
+  }
+  return lsx_read_dw_buf(ft, (uint32_t *)buf, len);
+}
+
+static int seek(sox_format_t * ft, uint64_t offset)
+{
+  priv_t * p = (priv_t *)ft->priv;
+
+  if (p->map) {
+    if (offset > (p->map_len - ft->data_start) / sizeof(sox_sample_t))
+      return SOX_EOF;
+    p->pos = ft->data_start + offset * sizeof(sox_sample_t);
+    return SOX_SUCCESS;
+  }
+  return lsx_rawseek(ft, offset);
+}
+
+static int stopread(sox_format_t * ft)
+{
+#ifdef HAVE_SYS_MMAN_H
+  priv_t * p = (priv_t *)ft->priv;
+
+  if (p->map)
+    munmap(p->map, p->map_len);
+#else
+  (void)ft;
+#endif
+  return SOX_SUCCESS;
 }
 
 static int write_header(sox_format_t * ft)
@@ -95,14 +172,22 @@ static int write_header(sox_format_t * ft)
   return error? SOX_EOF: SOX_SUCCESS;
 }
 
+static size_t write_samples(
+    sox_format_t * ft, sox_sample_t const * buf, size_t len)
+{
+  if (ft->encoding.reverse_bytes)
+    return lsx_rawwrite(ft, buf, len);
+  return lsx_writebuf(ft, buf, len * sizeof(*buf)) / sizeof(*buf);
+}
+
 LSX_FORMAT_HANDLER(sox)
 {
   static char const * const names[] = {"sox", NULL};
   static unsigned const write_encodings[] = {SOX_ENCODING_SIGN2, 32, 0, 0};
   static sox_format_handler_t const handler = {SOX_LIB_VERSION_CODE,
     "SoX native intermediate format", names, SOX_FILE_REWIND, 
-    startread, lsx_rawread, NULL, write_header, lsx_rawwrite, NULL,
-    lsx_rawseek, write_encodings, NULL, 0
+    startread, read_samples, stopread, write_header, write_samples, NULL,
+    seek, write_encodings, NULL, sizeof(priv_t)
   };
   return &handler;
 }
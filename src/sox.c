@@ -65,6 +65,23 @@
   #include <sys/ioctl.h>
 #endif
 
+#ifdef HAVE_SYS_RESOURCE_H
+  #include <sys/resource.h>
+#endif
+
+#if defined HAVE_SYS_SOCKET_H && defined HAVE_SYS_UN_H && defined HAVE_UNISTD_H
+  #include <sys/socket.h>
+  #include <sys/un.h>
+  #define METRICS_SOCKET
+  #ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0
+  #endif
+#endif
+
+#ifdef HAVE_DIRENT_H
+  #include <dirent.h>
+#endif
+
 #ifdef HAVE_GETTIMEOFDAY
   #define TIME_FRAC 1e6
 #else
@@ -87,6 +104,22 @@
 
 /*#define MORE_INTERACTIVE 1*/
 
+/* Counters read by the status thread are published atomically: */
+#if defined HAVE_PTHREAD_H && defined HAVE_STDATOMIC_H && defined HAVE_TERMIOS_H
+  #include <pthread.h>
+  #include <stdatomic.h>
+  #define STATUS_THREAD
+  typedef _Atomic uint64_t progress_t;
+  typedef _Atomic sox_sample_t level_t;
+  #define lock_stderr() flockfile(stderr)
+  #define unlock_stderr() funlockfile(stderr)
+#else
+  typedef uint64_t progress_t;
+  typedef sox_sample_t level_t;
+  #define lock_stderr()
+  #define unlock_stderr()
+#endif
+
 #define SOX_OPTS "SOX_OPTS"
 static lsx_getopt_t optstate;
 
@@ -167,6 +200,9 @@ static sox_bool very_first_effchain = sox_true;
      also that it has never been restarted. Only then we may use the
      optimize_trim() hack. */
 static char *effects_filename = NULL;
+static char *cue_list_name = NULL;
+static sox_bool split_on_silence = sox_false;
+static sox_bool cue_threads = sox_true;
 static char * play_rate_arg = NULL;
 static char *norm_level = NULL;
 
@@ -176,9 +212,9 @@ static sox_signalinfo_t combiner_signal, ofile_signal_options;
 static sox_encodinginfo_t combiner_encoding, ofile_encoding_options;
 static uint64_t mixing_clips = 0;
 static size_t current_input = 0;
-static uint64_t input_wide_samples = 0;
-static uint64_t read_wide_samples = 0;
-static uint64_t output_samples = 0;
+static progress_t input_wide_samples = 0;
+static progress_t read_wide_samples = 0;
+static progress_t output_samples = 0;
 static sox_bool input_eof = sox_false;
 static sox_bool output_eof = sox_false;
 static sox_bool user_abort = sox_false;
@@ -186,7 +222,20 @@ static sox_bool user_skip = sox_false;
 static sox_bool user_restart_eff = sox_false;
 static int success = 0;
 static int cleanup_called = 0;
-static sox_sample_t omax[2], omin[2];
+static level_t omax[2], omin[2];
+
+#ifdef STATUS_THREAD
+/* The progress display and keyboard are serviced by their own thread, so
+ * that the effects chain's callback need do no more than check flags: */
+static struct {
+  pthread_t thread;
+  int wake[2];          /* Pipe written to end the thread's wait */
+  sox_bool running;
+#ifdef MORE_INTERACTIVE
+  atomic_int key;       /* Key pressed, for the flowing thread to act on */
+#endif
+} status;
+#endif
 
 #ifdef HAVE_TERMIOS_H
 #include <termios.h>
@@ -452,8 +501,11 @@ static void progress_to_next_input_file(file_t * f, sox_effect_t * effp)
   read_wide_samples = 0;
   input_wide_samples = f->ft->signal.length / f->ft->signal.channels;
   if (show_progress && (sox_globals.verbosity < 3 ||
-                        (is_serial(combine_method) && input_count > 1)))
+                        (is_serial(combine_method) && input_count > 1))) {
+    lock_stderr();
     display_file_info(f->ft, f, sox_false);
+    unlock_stderr();
+  }
   if (f->volume == HUGE_VAL)
     f->volume = 1;
   if (f->replay_gain != HUGE_VAL)
@@ -628,17 +680,24 @@ static int output_flow(sox_effect_t *effp, sox_sample_t const * ibuf,
   size_t len;
 
   (void)effp, (void)obuf;
-  if (show_progress) for (len = 0; len < *isamp; len += effp->in_signal.channels) {
-    omax[0] = max(omax[0], ibuf[len]);
-    omin[0] = min(omin[0], ibuf[len]);
-    if (effp->in_signal.channels > 1) {
-      omax[1] = max(omax[1], ibuf[len + 1]);
-      omin[1] = min(omin[1], ibuf[len + 1]);
+  if (show_progress) {
+    sox_sample_t max0 = omax[0], min0 = omin[0], max1 = omax[1], min1 = omin[1];
+    for (len = 0; len < *isamp; len += effp->in_signal.channels) {
+      max0 = max(max0, ibuf[len]);
+      min0 = min(min0, ibuf[len]);
+      if (effp->in_signal.channels > 1) {
+        max1 = max(max1, ibuf[len + 1]);
+        min1 = min(min1, ibuf[len + 1]);
+      }
     }
-    else {
-      omax[1] = omax[0];
-      omin[1] = omin[0];
+    if (effp->in_signal.channels == 1) {
+      max1 = max0;
+      min1 = min0;
     }
+    omax[0] = max0;
+    omin[0] = min0;
+    omax[1] = max1;
+    omin[1] = min1;
   }
   *osamp = 0;
   len = *isamp? sox_write(ofile->ft, ibuf, *isamp) : 0;
@@ -1218,7 +1277,8 @@ static char const * vu(unsigned channel)
   };
   int const red = 1, white = array_length(text) - red;
   double const MAX = SOX_SAMPLE_MAX, MIN = SOX_SAMPLE_MIN;
-  double linear = max(omax[channel] / MAX, omin[channel] / MIN);
+  double hi = omax[channel] / MAX, lo = omin[channel] / MIN;
+  double linear = max(hi, lo);
   double dB = linear_to_dB(linear);
   int vu_dB = linear? floor(2 * white + red + dB) : 0;
   int index = vu_dB < 2 * white? max(vu_dB / 2, 0) : min(vu_dB - white, red + white - 1);
@@ -1252,19 +1312,30 @@ static void display_status(sox_bool all_done)
   if (all_done || since(&then, .1, sox_false)) {
     double read_time = (double)read_wide_samples / combiner_signal.rate;
     double left_time = 0, in_time = 0, percentage = 0;
-    char buf[128];
+    char buf[128], left[16];
+    sox_device_stats_t const * d = current_input < input_count?
+      &files[current_input]->ft->device : NULL;
 
     if (input_wide_samples) {
       in_time = (double)input_wide_samples / combiner_signal.rate;
       left_time = max(in_time - read_time, 0);
       percentage = max(100. * read_wide_samples / input_wide_samples, 0);
     }
+    /* With a capture thread, the time left (not known for a device) is
+     * replaced by the buffer's high-water mark and the frames dropped: */
+    if (!input_wide_samples && d && d->ring_size)
+      sprintf(left, "%5s|%-5s",
+          lsx_sigfigs3p(100. * d->ring_fill_max / d->ring_size),
+          lsx_sigfigs3((double)d->dropped));
+    else strcpy(left, str_time(left_time));
     snprintf(buf, min(termwidth + 2, sizeof(buf)),
       "\rIn:%-5s %s [%s] Out:%-5s [%6s|%-6s] %s Clip:%-5s",
-      lsx_sigfigs3p(percentage), str_time(read_time), str_time(left_time),
+      lsx_sigfigs3p(percentage), str_time(read_time), left,
       lsx_sigfigs3((double)output_samples),
       vu(0), vu(1), headroom(), lsx_sigfigs3((double)total_clips()));
+    lock_stderr();
     fputs(buf, stderr);
+    unlock_stderr();
   }
   if (all_done)
     fputc('\n', stderr);
@@ -1285,17 +1356,367 @@ static int kbhit(void)
 #define kbhit() 0
 #endif
 
-static int update_status(sox_bool all_done, void * client_data)
+/* With audio devices for both input and output, steers any variable-ratio
+ * rate effect (rate -V) so as to hold the audio buffered between them at
+ * the amount seen soon after starting, compensating for any difference
+ * between the devices' clocks.  The amount is measured afresh for each
+ * effects chain (see reset_drift), as a new chain starts with new buffers. */
+static struct {
+  double latency, target;  /* Seconds; 0 until measured, and set */
+  uint64_t start;          /* output_samples when the chain started */
+} drift;
+
+static void reset_drift(void)
+{
+  drift.latency = drift.target = 0;
+  drift.start = output_samples;
+}
+
+static void compensate_drift(void)
+{
+  #define DRIFT_GAIN .02       /* Ratio change per second of latency error */
+  #define DRIFT_MAX .002       /* Largest ratio change */
+  #define DRIFT_SMOOTHING .05
+  #define DRIFT_SETTLE 2       /* Seconds before the target latency is set */
+  sox_format_t * in, * out;
+  sox_device_stats_t const * d;
+  double change;
+  size_t i;
+
+  if (input_count != 1)
+    return;
+  in = files[0]->ft, out = ofile->ft;
+  if (!in || !out || !in->device.buffer_size || !out->device.buffer_size)
+    return;
+  d = &in->device;
+  change = (double)(d->fill + d->ring_fill) / in->signal.rate +
+    (double)out->device.fill / out->signal.rate;
+  drift.latency = drift.latency?
+    drift.latency + (change - drift.latency) * DRIFT_SMOOTHING : change;
+  if (!drift.target) {
+    if (output_samples - drift.start >= DRIFT_SETTLE * out->signal.rate)
+      drift.target = drift.latency;
+    return;
+  }
+  change = DRIFT_GAIN * (drift.latency - drift.target);
+  change = max(min(change, DRIFT_MAX), -DRIFT_MAX);
+  for (i = 0; i < effects_chain->length; ++i) {
+    sox_effect_t * effp = &effects_chain->effects[i][0];
+    if (strcmp(effp->handler.name, "rate") == 0)
+      sox_rate_set_ratio(effp, effp->in_signal.rate / effp->out_signal.rate *
+          (1 + change), sox_globals.bufsiz / effp->out_signal.channels);
+  }
+}
+
+typedef struct {char * str; size_t len, size;} json_t;
+
+static void json_cat(json_t * j, char const * s, size_t n)
+{
+  if (j->len + n + 1 > j->size)
+    j->str = lsx_realloc(j->str, j->size = (j->len + n + 1) * 2);
+  memcpy(j->str + j->len, s, n);
+  j->str[j->len += n] = '\0';
+}
+
+#define json_lit(j, s) json_cat(j, s, strlen(s))
+
+/* Returns the length of the UTF-8 sequence at s, or 0 if it is not valid
+ * (overlong, a surrogate, beyond U+10FFFF, or cut short). */
+static size_t utf8_len(unsigned char const * s)
+{
+  size_t n = s[0] < 0xc2? 0 : s[0] < 0xe0? 2 : s[0] < 0xf0? 3 : s[0] < 0xf5? 4 : 0;
+  size_t i;
+
+  for (i = 1; i < n; ++i)
+    if ((s[i] & 0xc0) != 0x80)
+      return 0;
+  if ((s[0] == 0xe0 && s[1] < 0xa0) || (s[0] == 0xed && s[1] >= 0xa0) ||
+      (s[0] == 0xf0 && s[1] < 0x90) || (s[0] == 0xf4 && s[1] >= 0x90))
+    return 0;
+  return n;
+}
+
+/* Control characters are escaped, and bytes that are not valid UTF-8
+ * (e.g. in a file name in another encoding) are replaced by U+FFFD. */
+static void json_str(json_t * j, char const * s)
+{
+  char buf[8];
+  size_t n;
+
+  json_lit(j, "\"");
+  for (; *s; s += n) {
+    unsigned char c = *s;
+    n = 1;
+    if (c == '"' || c == '\\')
+      buf[0] = '\\', buf[1] = c, buf[2] = '\0';
+    else if (c < ' ' || c == 0x7f)
+      sprintf(buf, "\\u%04x", c);
+    else if (c < 0x80)
+      buf[0] = c, buf[1] = '\0';
+    else if ((n = utf8_len((unsigned char const *)s)) != 0) {
+      json_cat(j, s, n);
+      continue;
+    }
+    else n = 1, strcpy(buf, "\\ufffd");
+    json_lit(j, buf);
+  }
+  json_lit(j, "\"");
+}
+
+/* JSON has no infinity or NaN */
+static void json_num(json_t * j, char const * key, char const * fmt, double x)
+{
+  char buf[64];
+
+  json_lit(j, key);
+  if (x != x || fabs(x) == HUGE_VAL)
+    strcpy(buf, "null");
+  else sprintf(buf, fmt, x);
+  json_lit(j, buf);
+}
+
+/* With --metrics, a line of JSON is written every metrics_interval seconds
+ * (and when each effects chain finishes) to a file, or to a UNIX domain
+ * socket if the given path is one.  The counters are read without locking,
+ * as for the progress display.  Lines that a socket reader is not ready for
+ * are dropped rather than holding up the audio; the connection is retried
+ * at the next interval if it fails. */
+static struct {
+  char * name;
+  double interval;
+  FILE * file;
+  int fd;
+  struct timeval then, last;
+  uint64_t * prev;        /* Counts at the last line: inputs, output, effects */
+} metrics = {NULL, 1, NULL, -1};
+
+/* Called from the progress display, so never waits: a reader whose
+ * backlog is full is tried again at the next interval.  A connection still
+ * in progress is used once made; a send before then fails, and retries. */
+static void metrics_connect(void)
+{
+#ifdef METRICS_SOCKET
+  struct sockaddr_un addr;
+  int flags;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, metrics.name, sizeof(addr.sun_path) - 1);
+  if ((metrics.fd = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0 &&
+      ((flags = fcntl(metrics.fd, F_GETFL)) == -1 ||
+       fcntl(metrics.fd, F_SETFL, flags | O_NONBLOCK) == -1 ||
+       (connect(metrics.fd, (struct sockaddr *)&addr, sizeof(addr)) &&
+        errno != EINPROGRESS))) {
+    close(metrics.fd);
+    metrics.fd = -1;
+  }
+#endif
+}
+
+static void open_metrics(void)
+{
+  struct stat st;
+
+  if (!metrics.name)
+    return;
+#ifdef METRICS_SOCKET
+  if (!stat(metrics.name, &st) && S_ISSOCK(st.st_mode)) {
+    metrics_connect();
+    if (metrics.fd < 0)
+      lsx_warn("can't connect to metrics socket `%s': %s", metrics.name, strerror(errno));
+    return;
+  }
+#else
+  (void)st;
+#endif
+  if (!(metrics.file = fopen(metrics.name, "a"))) {
+    lsx_fail("can't open metrics file `%s': %s", metrics.name, strerror(errno));
+    exit(1);
+  }
+}
+
+static uint64_t input_frames(size_t i)
+{
+  sox_format_t const * ft = files[i]->ft;
+  return ft? ft->olength / max(ft->signal.channels, 1) : 0;
+}
+
+static uint64_t output_frames(void)
+{
+  sox_format_t const * ft = ofile->ft;
+  return ft? ft->olength / max(ft->signal.channels, 1) : 0;
+}
+
+static uint64_t effect_frames(size_t e)
+{
+  sox_effect_t const * effp = &effects_chain->effects[e][0];
+  return effp->olength / max(effp->out_signal.channels, 1);
+}
+
+/* Starts the rates afresh for a new effects chain: */
+static void reset_metrics(void)
+{
+  size_t i;
+
+  if (!metrics.name)
+    return;
+  gettimeofday(&metrics.last, NULL);
+  metrics.then = metrics.last;
+  metrics.prev = lsx_realloc(metrics.prev,
+      (input_count + 1 + effects_chain->length) * sizeof(*metrics.prev));
+  for (i = 0; i < input_count; ++i)
+    metrics.prev[i] = input_frames(i);
+  metrics.prev[i++] = output_frames();
+  memset(metrics.prev + i, 0, effects_chain->length * sizeof(*metrics.prev));
+}
+
+static void json_device(json_t * j, sox_format_t const * ft)
+{
+  sox_device_stats_t const * d = ft? &ft->device : NULL;
+  char buf[256];
+
+  if (!d || (!d->buffer_size && !d->ring_size && !d->xruns)) {
+    json_lit(j, ",\"device\":null");
+    return;
+  }
+  sprintf(buf, ",\"device\":{\"xruns\":%" PRIu64 ",\"xrun_time\":%.6f,"
+      "\"buffer\":%" PRIu64 ",\"fill\":%" PRIu64 ",\"ring_size\":%" PRIu64
+      ",\"ring_fill\":%" PRIu64 ",\"dropped\":%" PRIu64 "}",
+      d->xruns, d->xrun_time, d->buffer_size, d->fill, d->ring_size,
+      d->ring_fill, d->dropped);
+  json_lit(j, buf);
+}
+
+/* Appends a count of frames and its rate since the last line: */
+static void json_count(json_t * j, uint64_t * prev, uint64_t now, double secs)
+{
+  char buf[64];
+  uint64_t n = now >= *prev? now - *prev : now;
+
+  if (secs > 0)
+    sprintf(buf, ",\"frames\":%" PRIu64 ",\"rate\":%.6f", now, n / secs);
+  else sprintf(buf, ",\"frames\":%" PRIu64 ",\"rate\":null", now);
+  json_lit(j, buf);
+  *prev = now;
+}
+
+static void json_resources(json_t * j)
+{
+  char buf[128];
+  FILE * statm = fopen("/proc/self/statm", "r");
+  unsigned long pages;
+
+  if (statm && fscanf(statm, "%*u %lu", &pages) == 1)
+    sprintf(buf, ",\"rss_kb\":%lu", pages * (unsigned long)sysconf(_SC_PAGESIZE) / 1024);
+  else strcpy(buf, ",\"rss_kb\":null");
+  if (statm)
+    fclose(statm);
+  json_lit(j, buf);
+#ifdef HAVE_SYS_RESOURCE_H
+  {
+    struct rusage ru;
+    if (!getrusage(RUSAGE_SELF, &ru)) {
+      sprintf(buf, ",\"cpu_user\":%.6f,\"cpu_sys\":%.6f",
+          ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6,
+          ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6);
+      json_lit(j, buf);
+      return;
+    }
+  }
+#endif
+  json_lit(j, ",\"cpu_user\":null,\"cpu_sys\":null");
+}
+
+static void write_metrics(void)
+{
+  json_t j = {NULL, 0, 0};
+  struct timeval now;
+  double secs;
+  char buf[128];
+  size_t i, f;
+
+  if (!metrics.file && metrics.fd < 0)
+    metrics_connect();
+  if (!metrics.file && metrics.fd < 0)
+    return;
+  gettimeofday(&now, NULL);
+  secs = now.tv_sec - metrics.last.tv_sec + (now.tv_usec - metrics.last.tv_usec) / TIME_FRAC;
+  metrics.last = now;
+  sprintf(buf, "{\"time\":%.6f,\"elapsed\":%.6f,\"inputs\":[",
+      now.tv_sec + now.tv_usec / TIME_FRAC,
+      now.tv_sec - load_timeofday.tv_sec + (now.tv_usec - load_timeofday.tv_usec) / TIME_FRAC);
+  json_lit(&j, buf);
+  for (i = 0; i < input_count; ++i) {
+    json_lit(&j, i? ",{\"file\":" : "{\"file\":");
+    json_str(&j, files[i]->filename);
+    json_count(&j, &metrics.prev[i], input_frames(i), secs);
+    json_device(&j, files[i]->ft);
+    json_lit(&j, "}");
+  }
+  json_lit(&j, "],\"output\":{\"file\":");
+  json_str(&j, ofile->ft? ofile->ft->filename : ofile->filename);
+  json_count(&j, &metrics.prev[i], output_frames(), secs);
+  sprintf(buf, ",\"clips\":%" PRIu64, ofile->ft? ofile->ft->clips : 0);
+  json_lit(&j, buf);
+  json_device(&j, ofile->ft);
+  json_lit(&j, "},\"effects\":[");
+  for (i = 1; i + 1 < effects_chain->length; ++i) {
+    sox_effect_t const * effp = &effects_chain->effects[i][0];
+    uint64_t clips = 0;
+    for (f = 0; f < effp->flows; ++f)
+      clips += effects_chain->effects[i][f].clips;
+    json_lit(&j, i > 1? ",{\"name\":" : "{\"name\":");
+    json_str(&j, effp->handler.name);
+    json_count(&j, &metrics.prev[input_count + 1 + i], effect_frames(i), secs);
+    sprintf(buf, ",\"buffered\":%" PRIuPTR ",\"clips\":%" PRIu64 "}",
+        (effp->oend - effp->obeg) / max(effp->out_signal.channels, 1), clips);
+    json_lit(&j, buf);
+  }
+  sprintf(buf, "],\"clips\":%" PRIu64, total_clips());
+  json_lit(&j, buf);
+  json_resources(&j);
+  json_lit(&j, "}\n");
+
+  if (metrics.file) {
+    fputs(j.str, metrics.file);
+    fflush(metrics.file);
+  }
+#ifdef METRICS_SOCKET
+  else {
+    ssize_t n = send(metrics.fd, j.str, j.len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0? errno != EAGAIN && errno != EWOULDBLOCK : (size_t)n != j.len) {
+      close(metrics.fd);   /* A partial line would garble the next one */
+      metrics.fd = -1;
+    }
+  }
+#endif
+  free(j.str);
+}
+
+static void close_metrics(void)
+{
+  if (metrics.file)
+    fclose(metrics.file);
+  if (metrics.fd >= 0)
+    close(metrics.fd);
+  metrics.file = NULL;
+  metrics.fd = -1;
+  free(metrics.prev);
+  free(metrics.name);
+  metrics.prev = NULL;
+  metrics.name = NULL;
+}
+static int read_key(void)
 {
-  (void)client_data;
-  if (interactive) while (kbhit()) {
-    int LSX_UNUSED ch;
 #ifdef HAVE_CONIO_H
-    ch = _getch();
+  return _getch();
 #else
-    ch = getchar();
+  return getchar();
 #endif
+}
 
+static void handle_key(int LSX_UNUSED ch)
+{
 #ifdef MORE_INTERACTIVE
     if (files[current_input]->ft->handler.seek &&
         files[current_input]->ft->seekable)
@@ -1333,9 +1754,102 @@ static int update_status(sox_bool all_done, void * client_data)
       user_restart_eff = sox_true;
     }
 #endif
+}
+
+#ifdef STATUS_THREAD
+/* Updates the progress display every 0.1s, writes the metrics when due,
+ * and reads the keyboard in interactive mode, until woken through
+ * status.wake. */
+static void * status_thread(void * arg)
+{
+  int fd = interactive? fileno(stdin) : -1;
+  sox_bool done = sox_false;
+
+  (void)arg;
+  while (!done) {
+    struct timeval timeout = {0, TIME_FRAC / 10};
+    fd_set fdset;
+
+    FD_ZERO(&fdset);
+    FD_SET(status.wake[0], &fdset);
+    if (fd >= 0)
+      FD_SET(fd, &fdset);
+    if (select(max(status.wake[0], fd) + 1, &fdset, NULL, NULL, &timeout) > 0) {
+      done = FD_ISSET(status.wake[0], &fdset);
+      if (fd >= 0 && FD_ISSET(fd, &fdset)) while (kbhit()) {
+        int LSX_UNUSED ch = read_key();
+#ifdef MORE_INTERACTIVE
+        atomic_store(&status.key, ch);
+#endif
+      }
+    }
+    if (!done) {
+      display_status(sox_false);
+      if (metrics.name && since(&metrics.then, metrics.interval, sox_false))
+        write_metrics();
+    }
   }
+  return NULL;
+}
 
+static void start_status_thread(void)
+{
+  if (status.running || (!show_progress && !interactive && !metrics.name))
+    return;
+  if (pipe(status.wake))
+    return;
+  if (pthread_create(&status.thread, NULL, status_thread, NULL)) {
+    close(status.wake[0]);
+    close(status.wake[1]);
+    return;
+  }
+  status.running = sox_true;
+}
+
+static void stop_status_thread(void)
+{
+  if (!status.running)
+    return;
+  if (write(status.wake[1], "", (size_t)1) == 1)
+    pthread_join(status.thread, NULL);
+  else pthread_cancel(status.thread);
+  close(status.wake[0]);
+  close(status.wake[1]);
+  status.running = sox_false;
+}
+#else
+#define start_status_thread()
+#define stop_status_thread()
+#endif
+
+static int update_status(sox_bool all_done, void * client_data)
+{
+  (void)client_data;
+#ifdef STATUS_THREAD
+  if (status.running) {
+#ifdef MORE_INTERACTIVE
+    int ch = atomic_exchange(&status.key, 0);
+    if (ch)
+      handle_key(ch);
+#endif
+    compensate_drift();
+    if (all_done || user_abort) {
+      stop_status_thread();
+      display_status(sox_true);
+      if (metrics.name)
+        write_metrics();
+    }
+    return (user_abort || user_restart_eff) ? SOX_EOF : SOX_SUCCESS;
+  }
+#endif
+  if (interactive) while (kbhit())
+    handle_key(read_key());
+
+  compensate_drift();
   display_status(all_done || user_abort);
+  if (metrics.name && (all_done || user_abort ||
+        since(&metrics.then, metrics.interval, sox_false)))
+    write_metrics();
   return (user_abort || user_restart_eff) ? SOX_EOF : SOX_SUCCESS;
 }
 
@@ -1366,6 +1880,45 @@ static void optimize_trim(void)
   }
 }
 
+/* Speed hack.  If there is just one input and no effects (auto-dither
+ * included, so e.g. u-law to A-law needs -D), and the input's samples can
+ * be copied to the output without converting them to and from
+ * sox_sample_t, then bypass the effects chain. */
+static sox_bool can_transcode(void)
+{
+  return input_count == 1 && effects_chain->length == 2 &&
+    files[0]->volume == 1 && sox_can_transcode(files[0]->ft, ofile->ft);
+}
+
+static int transcode(void)
+{
+  sox_format_t * ift = files[0]->ft, * oft = ofile->ft;
+  size_t len = sox_globals.bufsiz - sox_globals.bufsiz % ift->signal.channels;
+  size_t olen;
+  int status = SOX_SUCCESS;
+
+  lsx_debug("transcoding without effects");
+  oft->sox_errno = 0;
+  do {
+    olen = user_skip? 0 : sox_transcode(ift, oft, len);
+    read_wide_samples += olen / ift->signal.channels;
+    output_samples += olen / oft->signal.channels;
+  } while (olen && (status = update_status(sox_false, NULL)) == SOX_SUCCESS);
+
+  if (oft->sox_errno) {
+    lsx_fail("`%s' %s: %s", oft->filename,
+        oft->sox_errstr, sox_strerror(oft->sox_errno));
+    output_eof = sox_true;
+    return SOX_EOF;
+  }
+  if (status == SOX_SUCCESS) {
+    input_eof = sox_true;
+    ++current_input;
+    status = update_status(sox_true, NULL);
+  }
+  return status;
+}
+
 static sox_bool overwrite_permitted(char const * filename)
 {
   char c;
@@ -1777,7 +2330,12 @@ static int process(void)
     d = now.tv_sec - load_timeofday.tv_sec + (now.tv_usec - load_timeofday.tv_usec) / TIME_FRAC;
     lsx_debug("start-up time = %g", d);
   }
-  flow_status = sox_flow_effects(effects_chain, update_status, NULL);
+  reset_drift();
+  reset_metrics();
+  start_status_thread();
+  flow_status = can_transcode()? transcode() :
+    sox_flow_effects(effects_chain, update_status, NULL);
+  stop_status_thread();
 
   /* Don't return SOX_EOF if
    * 1) input reach EOF and there are more input files to process or
@@ -1907,6 +2465,10 @@ static void usage(char const * message)
 "--combine concatenate    Concatenate all input files (default for sox, rec)",
 "--combine sequence       Sequence all input files (default for play)",
 "-D, --no-dither          Don't dither automatically",
+"--device-buffer FRAMES   Set the audio device buffer size (where supported)",
+"--device-period FRAMES   Set the audio device period size (where supported)",
+"--capture-buffer FRAMES  Read audio capture devices on a separate thread",
+"--cue-list FILENAME      Cut the clips listed in FILENAME from the input file",
 "--dft-min NUM            Minimum size (log2) for DFT processing (default 10)",
 "--effects-file FILENAME  File containing effects and options",
 "-G, --guard              Use temporary files to guard against clipping",
@@ -1927,6 +2489,8 @@ static void usage(char const * message)
 "--multi-threaded         Enable parallel effects channels processing"
   };
   static char const * const lines3[] = {
+"--metrics FILENAME       Write progress metrics as JSON lines to FILENAME",
+"--metrics-interval SECS  Seconds between lines of metrics; default 1",
 "--norm                   Guard (see --guard) & normalise",
 "--play-rate-arg ARG      Default `rate' argument for auto-resample with `play'",
 "--plot gnuplot|octave    Generate script to plot response of filter effect",
@@ -1935,6 +2499,7 @@ static void usage(char const * message)
 "-R                       Use default random numbers (same on each run of SoX)",
 "-S, --show-progress      Display progress while processing audio data",
 "--single-threaded        Disable parallel effects channels processing",
+"--split                  Write each part kept by silence to a numbered file",
 "--temp DIRECTORY         Specify the directory to use for temporary files",
 "-T, --combine multiply   Multiply samples of corresponding channels from all",
 "                         input files (instead of concatenating)",
@@ -2172,6 +2737,13 @@ static struct lsx_option_t const long_options[] = {
   {"no-clobber"      , lsx_option_arg_none    , NULL, 0},
   {"multi-threaded"  , lsx_option_arg_none    , NULL, 0},
   {"dft-min"         , lsx_option_arg_required, NULL, 0},
+  {"device-buffer"   , lsx_option_arg_required, NULL, 0},
+  {"device-period"   , lsx_option_arg_required, NULL, 0},
+  {"capture-buffer"  , lsx_option_arg_required, NULL, 0},
+  {"cue-list"        , lsx_option_arg_required, NULL, 0},
+  {"split"           , lsx_option_arg_none    , NULL, 0},
+  {"metrics"         , lsx_option_arg_required, NULL, 0},
+  {"metrics-interval", lsx_option_arg_required, NULL, 0},
 
   {"bits"            , lsx_option_arg_required, NULL, 'b'},
   {"channels"        , lsx_option_arg_required, NULL, 'c'},
@@ -2342,7 +2914,7 @@ static char parse_gopts_and_fopts(file_t * f)
       case 14: break;
       case 15: effects_filename = lsx_strdup(optstate.arg); break;
       case 16: sox_globals.tmp_path = lsx_strdup(optstate.arg); break;
-      case 17: sox_globals.use_threads = sox_false; break;
+      case 17: sox_globals.use_threads = cue_threads = sox_false; break;
       case 18: f->signal.length = SOX_IGNORE_LENGTH; break;
       case 19: do_guarded_norm = is_guarded = sox_true;
         norm_level = lsx_strdup(optstate.arg);
@@ -2364,6 +2936,34 @@ static char parse_gopts_and_fopts(file_t * f)
         }
         sox_globals.log2_dft_min_size = i;
         break;
+      case 26: case 27:
+        if (sscanf(optstate.arg, "%i %c", &i, &dummy) != 1 || i <= 0) {
+          lsx_fail("Device %s size `%s' must be a positive number of frames",
+              optstate.lngind == 26? "buffer" : "period", optstate.arg);
+          exit(1);
+        }
+        *(optstate.lngind == 26? &sox_globals.device_buffer : &sox_globals.device_period) = i;
+        break;
+
+      case 28:
+        if (sscanf(optstate.arg, "%i %c", &i, &dummy) != 1 || i <= 0) {
+          lsx_fail("Capture buffer size `%s' must be a positive number of frames", optstate.arg);
+          exit(1);
+        }
+        sox_globals.capture_buffer = i;
+        break;
+
+      case 29: cue_list_name = lsx_strdup(optstate.arg); break;
+      case 30: split_on_silence = sox_true; break;
+      case 31: metrics.name = lsx_strdup(optstate.arg); break;
+
+      case 32:
+        if (sscanf(optstate.arg, "%lf %c", &metrics.interval, &dummy) != 1 ||
+            metrics.interval < .1) {
+          lsx_fail("Metrics interval `%s' must be at least 0.1 seconds", optstate.arg);
+          exit(1);
+        }
+        break;
       }
       break;
 
@@ -2657,15 +3257,18 @@ static void parse_options_and_filenames(int argc, char **argv)
   }
   if (sox_mode == sox_play)
     add_file(&opts, set_default_device(&opts));
+  else if (cue_list_name)  /* Any trailing fopts are for the clips */
+    add_file(&opts, "");
   else if (memcmp(&opts, &opts_none, sizeof(opts))) /* fopts but no file */
     add_file(&opts, device_name(opts.filetype));
 }
 
 static double soxi_total;
 static size_t soxi_file_count;
+static sox_bool soxi_recurse;
 
 typedef enum {Full, Type, Rate, Channels, Samples, Duration, Duration_secs,
-    Bits, Bitrate, Precision, Encoding, Annotation} soxi_t;
+    Bits, Bitrate, Precision, Encoding, Annotation, Json} soxi_t;
 
 static int soxi1(soxi_t const * type, char const * filename)
 {
@@ -2700,19 +3303,192 @@ static int soxi1(soxi_t const * type, char const * filename)
     }
     break;
     case Full: display_file_info(ft, NULL, sox_false); break;
+    case Json: break;
   }
   return !!sox_close(ft);
 }
 
+/* With -j, each file's information is formatted as a line of JSON; files
+ * are taken SOXI_BATCH at a time and their lines output in the order
+ * given.  Format handlers and sox_globals are not thread-safe, so the files
+ * are opened one at a time; but first, the start of each file, where the
+ * headers are, is read in parallel (if OpenMP is available), so that the
+ * opens find it cached rather than each waiting on the disk in turn. */
+
+#define SOXI_BATCH 256
+#define SOXI_PREFETCH 65536
+static char * soxi_names[SOXI_BATCH];
+static size_t soxi_queued;
+#define SOXI_FAIL_LEN 256
+static char * soxi_fail; /* If set, where the reason that an open fails is kept */
+
+static void soxi_prefetch(char const * filename)
+{
+  FILE * f = fopen(filename, "rb");
+  char * buf = f? lsx_malloc(SOXI_PREFETCH) : NULL;
+
+  if (f) {
+    size_t n = fread(buf, 1, SOXI_PREFETCH, f);
+    (void)n;
+    fclose(f);
+  }
+  free(buf);
+}
+
+static int soxi_json(char const * filename, char * * result)
+{
+  sox_format_t * ft;
+  json_t j = {NULL, 0, 0};
+  char buf[128], fail[SOXI_FAIL_LEN];
+  int error = 1;
+
+  *(soxi_fail = fail) = '\0';
+  ft = sox_open_read(filename, NULL, NULL, NULL);
+  json_lit(&j, "{\"file\":");
+  json_str(&j, filename);
+  if (ft) {
+    uint64_t ws = ft->signal.length / max(ft->signal.channels, 1);
+    sox_comments_t p = ft->oob.comments;
+
+    json_lit(&j, ",\"type\":");
+    json_str(&j, ft->filetype);
+    json_num(&j, ",\"rate\":", "%g", ft->signal.rate);
+    sprintf(buf, ",\"channels\":%u,\"precision\":%u,\"bits\":%u",
+        ft->signal.channels, ft->signal.precision,
+        ft->encoding.bits_per_sample);
+    json_lit(&j, buf);
+    json_lit(&j, ",\"encoding\":");
+    json_str(&j, sox_encodings_info[ft->encoding.encoding].desc);
+    if (ws && ft->signal.rate) {
+      sprintf(buf, ",\"samples\":%" PRIu64, ws);
+      json_lit(&j, buf);
+      json_num(&j, ",\"duration\":", "%.6f", (double)ws / ft->signal.rate);
+    }
+    else json_lit(&j, ",\"samples\":null,\"duration\":null");
+    json_lit(&j, ",\"comments\":[");
+    for (; p && *p; ++p) {
+      if (p != ft->oob.comments)
+        json_lit(&j, ",");
+      json_str(&j, *p);
+    }
+    json_lit(&j, "]");
+    error = !!sox_close(ft);
+  }
+  if (error) {
+    json_lit(&j, ",\"error\":");
+    json_str(&j, *fail? fail : "unknown error");
+  }
+  soxi_fail = NULL;
+  json_lit(&j, "}\n");
+  *result = j.str;
+  return error;
+}
+
+static int soxi_flush(void)
+{
+  char * lines[SOXI_BATCH];
+  int i, n = (int)soxi_queued, errors = 0;
+
+#ifdef HAVE_OPENMP
+  #pragma omp parallel for if(sox_globals.use_threads) schedule(dynamic)
+#endif
+  for (i = 0; i < n; ++i)
+    soxi_prefetch(soxi_names[i]);
+  for (i = 0; i < n; ++i)
+    errors += soxi_json(soxi_names[i], &lines[i]);
+  for (i = 0; i < n; ++i) {
+    fputs(lines[i], stdout);
+    free(lines[i]);
+    free(soxi_names[i]);
+  }
+  soxi_file_count += n;
+  soxi_queued = 0;
+  return errors;
+}
+
+static int soxi_file(soxi_t const * type, char const * filename)
+{
+  if (*type != Json)
+    return soxi1(type, filename);
+  soxi_names[soxi_queued++] = lsx_strdup(filename);
+  return soxi_queued == SOXI_BATCH? soxi_flush() : 0;
+}
+
+#ifdef HAVE_DIRENT_H
+/* Visits the files in a directory tree; symbolic links to directories are
+ * not followed, so that the walk always terminates. */
+static int soxi_dir(soxi_t const * type, char const * dirname)
+{
+  DIR * dir = opendir(dirname);
+  struct dirent * entry;
+  struct stat st;
+  int errors = 0;
+
+  if (!dir) {
+    lsx_fail("can't open directory `%s': %s", dirname, strerror(errno));
+    return 1;
+  }
+  while ((entry = readdir(dir))) {
+    char * path;
+    if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+      continue;
+    path = lsx_malloc(strlen(dirname) + strlen(entry->d_name) + 2);
+    sprintf(path, "%s/%s", dirname, entry->d_name);
+    if (!lstat(path, &st) && S_ISDIR(st.st_mode))
+      errors += soxi_dir(type, path);
+    else if (!stat(path, &st) && S_ISREG(st.st_mode))
+      errors += soxi_file(type, path);
+    free(path);
+  }
+  closedir(dir);
+  return errors;
+}
+#endif
+
+static int soxi_arg(soxi_t const * type, char const * name)
+{
+#ifdef HAVE_DIRENT_H
+  struct stat st;
+  if (soxi_recurse && !stat(name, &st) && S_ISDIR(st.st_mode))
+    return soxi_dir(type, name);
+#endif
+  if (sox_is_playlist(name))
+    return sox_parse_playlist((sox_playlist_callback_t)soxi_file, (void *)type, name) != SOX_SUCCESS;
+  return soxi_file(type, name);
+}
+
+static int soxi_list(soxi_t const * type, char const * listname)
+{
+  FILE * list = strcmp(listname, "-")? fopen(listname, "r") : stdin;
+  char line[FILENAME_MAX + 2];
+  int errors = 0;
+
+  if (!list) {
+    lsx_fail("can't open file list `%s': %s", listname, strerror(errno));
+    return 1;
+  }
+  while (fgets(line, (int)sizeof(line), list)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (*line)
+      errors += soxi_arg(type, line);
+  }
+  if (list != stdin)
+    fclose(list);
+  return errors;
+}
+
 static void soxi_usage(int return_code)
 {
   display_SoX_version(stdout);
   printf(
     "\n"
-    "Usage: soxi [-V[level]] [-T] [-t|-r|-c|-s|-d|-D|-b|-B|-p|-e|-a] infile1 ...\n"
+    "Usage: soxi [-V[level]] [-T] [-j] [-R] [-L list] [-t|-r|-c|-s|-d|-D|-b|-B|-p|-e|-a] infile1 ...\n"
     "\n"
     "-V[n]\tIncrement or set verbosity level (default is 2)\n"
     "-T\tWith -s, -d or -D, display the total across all given files\n"
+    "-j\tShow the information for each file as a line of JSON\n"
+    "-R\tInclude the files in the directory trees given as infiles\n"
+    "-L list\tRead further infile names from the file `list' (- for stdin)\n"
     "\n"
     "-t\tShow detected file-type\n"
     "-r\tShow sample-rate\n"
@@ -2735,10 +3511,11 @@ static void soxi_usage(int return_code)
 
 static int soxi(int argc, char * const * argv)
 {
-  static char const opts[] = "trcsdDbBpea?TV::";
+  static char const opts[] = "trcsdDbBpea?TV::jRL:";
   soxi_t type = Full;
   int opt, num_errors = 0;
   sox_bool do_total = sox_false;
+  char const * listname = NULL;
 
   if (argc < 2)
     soxi_usage(0);
@@ -2760,22 +3537,35 @@ static int soxi(int argc, char * const * argv)
     }
     else if (opt == 'T')
       do_total = sox_true;
+    else if (opt == 'j')
+      type = Json;
+    else if (opt == 'R')
+      soxi_recurse = sox_true;
+    else if (opt == 'L')
+      listname = optstate.arg;
     else if ((type = 1 + (strchr(opts, opt) - opts)) > Annotation)
       soxi_usage(1);
 
-  if (type == Full)
+  if (type == Json) {
+    /* Only the headers are needed, and many files are being scanned: */
+    sox_globals.quick_length = sox_true;
+    sox_globals.use_threads = sox_true;
+    do_total = sox_false;
+  }
+  else if (type == Full)
     do_total = sox_true;
   else if (do_total && (type < Samples || type > Duration_secs)) {
     fprintf(stderr, "soxi: ignoring -T; n/a with other given option");
     do_total = sox_false;
   }
   soxi_total = -!do_total;
-  for (; optstate.ind < argc; ++optstate.ind) {
-    if (sox_is_playlist(argv[optstate.ind]))
-      num_errors += (sox_parse_playlist((sox_playlist_callback_t)soxi1, &type, argv[optstate.ind]) != SOX_SUCCESS);
-    else num_errors += soxi1(&type, argv[optstate.ind]);
-  }
-  if (type == Full) {
+  for (; optstate.ind < argc; ++optstate.ind)
+    num_errors += soxi_arg(&type, argv[optstate.ind]);
+  if (listname)
+    num_errors += soxi_list(&type, listname);
+  if (type == Json)
+    num_errors += soxi_flush();
+  else if (type == Full) {
     if (soxi_file_count > 1 && soxi_total > 0)
       printf("Total Duration of %u files: %s\n", (unsigned)soxi_file_count, str_time(soxi_total));
   }
@@ -2809,12 +3599,466 @@ static void set_replay_gain(sox_comments_t comments, file_t * f)
   }
 }
 
+/* Cue lists: each line gives a clip to cut from the one input file, as
+ *   start, duration, output-file [, effect [effopt]]...
+ * Each clip is processed by an effects chain of its own, with trim seeking
+ * the input to the clip's start; clips are processed in parallel, each
+ * thread having its own reader of the input. */
+
+typedef struct {
+  char * start, * duration, * filename; /* Point into line */
+  int argc;
+  char * * argv;                        /* Effects for this clip only */
+  char * line;
+} cue_t;
+
+static void seed_prng(void)
+{
+  if (!sox_globals.repeatable) {/* Re-seed PRNG? */
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    sox_globals.ranqd1 = (int32_t)(now.tv_sec - now.tv_usec);
+  }
+}
+
+static cue_t * cues = NULL;
+static size_t cue_count = 0;
+static int32_t cue_seed;  /* The PRNG seed for the first clip */
+
+/* Returns the next comma-separated field, without surrounding white space. */
+static char * cue_field(char * * s)
+{
+  char * f = *s, * end = f + strcspn(f, ","), * t = end;
+
+  *s = *end? end + 1 : end;
+  *end = '\0';
+  for (; isspace((unsigned char)*f); ++f);
+  for (; t > f && isspace((unsigned char)t[-1]); *--t = '\0');
+  return f;
+}
+
+static void read_cue_list(char const * listname)
+{
+  FILE * list = strcmp(listname, "-")? fopen(listname, "r") : stdin;
+  char line[FILENAME_MAX + 1024], * s;
+  unsigned long line_num = 0;
+
+  if (!list) {
+    lsx_fail("can't open cue list `%s': %s", listname, strerror(errno));
+    exit(1);
+  }
+  while (fgets(line, (int)sizeof(line), list)) {
+    cue_t * cue;
+    ++line_num;
+    if (!strchr(line, '\n') && !feof(list)) {
+      lsx_fail("%s:%lu: line too long", listname, line_num);
+      exit(1);
+    }
+    line[strcspn(line, "\r\n")] = '\0';
+    for (s = line; isspace((unsigned char)*s); ++s);
+    if (!*s || *s == '#')
+      continue;
+    lsx_revalloc(cues, cue_count + 1);
+    cue = &cues[cue_count++];
+    cue->line = s = lsx_strdup(s);
+    cue->start = cue_field(&s);
+    cue->duration = cue_field(&s);
+    cue->filename = cue_field(&s);
+    cue->argv = strtoargv(s, &cue->argc);
+    if (!*cue->start || !*cue->filename) {
+      lsx_fail("%s:%lu: a start and an output file name are needed", listname, line_num);
+      exit(1);
+    }
+    if (cue->argc && !sox_find_effect(cue->argv[0])) {
+      lsx_fail("%s:%lu: `%s' is not an effect", listname, line_num, cue->argv[0]);
+      exit(1);
+    }
+  }
+  if (ferror(list)) {
+    lsx_fail("error reading cue list `%s': %s", listname, strerror(errno));
+    exit(1);
+  }
+  if (list != stdin)
+    fclose(list);
+}
+
+static sox_effect_t * cue_effect(char const * name, int argc, char * * argv)
+{
+  sox_effect_handler_t const * handler = sox_find_effect(name);
+  sox_effect_t * effp;
+
+  if (!handler || (handler->flags & SOX_EFF_INTERNAL)) {
+    lsx_fail("`%s' is not a usable effect", name);
+    return NULL;
+  }
+  effp = sox_create_effect(handler);
+  if (sox_effect_options(effp, argc, argv) == SOX_SUCCESS)
+    return effp;
+  effp->handler.kill(effp);
+  free(effp->priv);
+  free(effp);
+  return NULL;
+}
+
+static void cue_auto_effect(sox_effects_chain_t * chain, char const * name,
+    sox_signalinfo_t * signal, sox_signalinfo_t const * out, int * status)
+{
+  sox_effect_t * effp = cue_effect(name, 0, NULL);
+
+  if (!effp || sox_add_effect(chain, effp, signal, out) != SOX_SUCCESS)
+    *status = SOX_EOF;
+  free(effp);
+}
+
+/* With --split, the clips are the parts of the input that the silence
+ * effect (first in the chain) keeps; this runs it over the input alone to
+ * find them, after which the clips are cut as for a cue list. */
+static void find_split_segments(void)
+{
+  file_t const * f = files[0];
+  sox_format_t * in, * out = NULL;
+  sox_effects_chain_t * chain;
+  sox_effect_t * effp, * detector = NULL;
+  sox_signalinfo_t signal;
+  sox_uint64_t const * segments;
+  size_t i, n = 0;
+  char * args[1];
+  int status = SOX_SUCCESS;
+
+  if (!nuser_effects[0] || strcmp(user_effargs[0][0].name, "silence"))
+    usage("--split needs the silence effect to be the first effect");
+  if (!(in = sox_open_read(f->filename, &f->signal, &f->encoding, f->filetype)))
+    exit(2);
+  signal = in->signal;
+  chain = sox_create_effects_chain(&in->encoding, NULL);
+
+  effp = sox_create_effect(sox_find_effect("input"));
+  args[0] = (char *)in;
+  if (sox_effect_options(effp, 1, args) != SOX_SUCCESS ||
+      sox_add_effect(chain, effp, &signal, &signal) != SOX_SUCCESS)
+    status = SOX_EOF;
+  free(effp);
+  signal.precision = in->signal.precision;
+
+  if (status == SOX_SUCCESS && (effp = cue_effect(user_effargs[0][0].name,
+          user_effargs[0][0].argc, user_effargs[0][0].argv))) {
+    if (sox_add_effect(chain, effp, &signal, &in->signal) == SOX_SUCCESS)
+      detector = &chain->effects[chain->length - 1][0];
+    else {
+      effp->handler.kill(effp);
+      free(effp->priv);
+    }
+    free(effp);
+  }
+  if (detector && (out = sox_open_write("", &signal, NULL, "null", NULL, NULL))) {
+    effp = sox_create_effect(sox_find_effect("output"));
+    args[0] = (char *)out;
+    if (sox_effect_options(effp, 1, args) != SOX_SUCCESS ||
+        sox_add_effect(chain, effp, &signal, &signal) != SOX_SUCCESS)
+      status = SOX_EOF;
+    free(effp);
+    if (status == SOX_SUCCESS) {
+      sox_flow_effects(chain, NULL, NULL);
+      if (in->sox_errno)
+        status = SOX_EOF;
+    }
+  }
+  else status = SOX_EOF;
+
+  if (status == SOX_SUCCESS) {
+    n = sox_silence_get_segments(detector, &segments);
+    for (i = 0; i < n; ++i) {
+      char * filename = fndup_with_count(ofile->filename, i + 1);
+      cue_t * cue;
+
+      lsx_revalloc(cues, cue_count + 1);
+      cue = &cues[cue_count++];
+      memset(cue, 0, sizeof(*cue));
+      cue->line = lsx_malloc(2 * 22 + strlen(filename) + 1);
+      cue->start = cue->line;
+      cue->duration = cue->start + 1 + sprintf(cue->start, "%" PRIu64 "s",
+          segments[2 * i]);
+      cue->filename = cue->duration + 1 + sprintf(cue->duration, "%" PRIu64 "s",
+          segments[2 * i + 1] - segments[2 * i]);
+      strcpy(cue->filename, filename);
+      free(filename);
+    }
+  }
+  sox_delete_effects_chain(chain);
+  if (out)
+    sox_close(out);
+  sox_close(in);
+  if (status != SOX_SUCCESS) {
+    lsx_fail("`%s': can't find the parts to split", f->filename);
+    exit(2);
+  }
+  lsx_report("%lu parts to split", (unsigned long)n);
+}
+
+/* Opens *in if it is not already open, and the clip's output, and builds
+ * its effects chain.  *can_seek says whether *in can be repositioned;
+ * ->seekable isn't cleared for that as handlers such as 8svx also seek the
+ * file themselves.  Format handlers, and effects that seed from the global
+ * PRNG as they start (e.g. dither), aren't thread-safe, so this is called
+ * by one thread at a time; the PRNG is seeded from the clip's index so
+ * that with -R the output doesn't depend on the order clips are run in. */
+static int cue_setup(cue_t const * cue, sox_format_t * * in, sox_bool * can_seek,
+    sox_format_t * * out, sox_effects_chain_t * * chain)
+{
+  file_t const * f = files[0], * opts = ofile;
+  sox_effect_t * * efftab = NULL, * effp;
+  size_t neffects = 0, added = 0, i;
+  sox_signalinfo_t signal, out_signal = opts->signal;
+  sox_encodinginfo_t out_encoding = opts->encoding, t;
+  sox_oob_t oob;
+  char * args[2];
+  int j, k, status = SOX_SUCCESS;
+
+  sox_globals.ranqd1 = cue_seed + (int32_t)(cue - cues);
+
+  if (*in && !*can_seek)  /* Can't go back, so start again */
+    sox_close(*in), *in = NULL;
+  if (!*in) {
+    if (!(*in = sox_open_read(f->filename, &f->signal, &f->encoding, f->filetype)))
+      return SOX_EOF;
+    *can_seek = sox_seek(*in, (sox_uint64_t)0, SOX_SEEK_SET) == SOX_SUCCESS;
+    (*in)->sox_errno = 0;
+  }
+
+  /* Create the command-line effects, then the clip's own: */
+  for (i = split_on_silence; i < nuser_effects[0]; ++i) {
+    lsx_revalloc(efftab, neffects + 1);
+    if (!(efftab[neffects++] = cue_effect(user_effargs[0][i].name,
+            user_effargs[0][i].argc, user_effargs[0][i].argv)))
+      status = SOX_EOF;
+  }
+  for (j = 0; j < cue->argc; j = k) {
+    for (k = j + 1; k < cue->argc && !sox_find_effect(cue->argv[k]); ++k);
+    lsx_revalloc(efftab, neffects + 1);
+    if (!(efftab[neffects++] = cue_effect(cue->argv[j], k - j - 1, cue->argv + j + 1)))
+      status = SOX_EOF;
+  }
+
+  /* As calculate_output_signal_parameters: */
+  for (i = neffects; status == SOX_SUCCESS && i-- && !out_signal.rate;)
+    out_signal.rate = efftab[i]->out_signal.rate;
+  for (i = neffects; status == SOX_SUCCESS && i-- && !out_signal.channels;)
+    out_signal.channels = efftab[i]->out_signal.channels;
+  if (!out_signal.rate)
+    out_signal.rate = (*in)->signal.rate;
+  if (!out_signal.channels)
+    out_signal.channels = (*in)->signal.channels;
+  out_signal.precision = (*in)->signal.precision;
+  out_signal.length = SOX_UNKNOWN_LEN;
+  t = out_encoding;
+  if (!t.encoding)
+    t.encoding = (*in)->encoding.encoding;
+  if (!t.bits_per_sample)
+    t.bits_per_sample = (*in)->encoding.bits_per_sample;
+  if (sox_format_supports_encoding(cue->filename, opts->filetype, &t))
+    out_encoding = t;
+
+  memset(&oob, 0, sizeof(oob));
+  oob.comments = sox_copy_comments((*in)->oob.comments);
+  if (status == SOX_SUCCESS && !(*out = sox_open_write(cue->filename,
+          &out_signal, &out_encoding, opts->filetype, &oob, overwrite_permitted)))
+    status = SOX_EOF;
+  sox_delete_comments(&oob.comments);
+
+  if (status == SOX_SUCCESS) {
+    sox_effect_t * trim;
+    sox_uint64_t offset;
+
+    *chain = sox_create_effects_chain(&(*in)->encoding, &(*out)->encoding);
+    signal = (*in)->signal;
+    effp = sox_create_effect(sox_find_effect("input"));
+    args[0] = (char *)*in;
+    if (sox_effect_options(effp, 1, args) != SOX_SUCCESS ||
+        sox_add_effect(*chain, effp, &signal, &signal) != SOX_SUCCESS)
+      status = SOX_EOF;
+    free(effp);
+    signal.precision = (*in)->signal.precision; /* Not lost by reading */
+
+    args[0] = cue->start, args[1] = cue->duration;
+    effp = sox_create_effect(sox_find_effect("trim"));
+    if (status == SOX_SUCCESS && (sox_effect_options(effp, 1 + !!*args[1], args)
+          != SOX_SUCCESS || sox_add_effect(*chain, effp, &signal, &(*out)->signal)
+          != SOX_SUCCESS))
+      status = SOX_EOF;
+    free(effp);
+
+    /* As optimize_trim, but a reused reader must always be repositioned: */
+    if (status == SOX_SUCCESS && *can_seek) {
+      trim = &(*chain)->effects[(*chain)->length - 1][0];
+      offset = sox_trim_get_start(trim);
+      if ((*in)->signal.length != SOX_UNSPEC)
+        offset = min(offset, (*in)->signal.length);
+      if (sox_seek(*in, offset, SOX_SEEK_SET) != SOX_SUCCESS) {
+        lsx_fail("`%s': can't seek", f->filename);
+        status = SOX_EOF;
+      }
+      else sox_trim_clear_start(trim);
+    }
+
+    for (; status == SOX_SUCCESS && added < neffects; ++added)
+      if (sox_add_effect(*chain, efftab[added], &signal, &(*out)->signal) != SOX_SUCCESS) {
+        status = SOX_EOF;
+        break;
+      }
+    if (status == SOX_SUCCESS && signal.channels != (*out)->signal.channels)
+      cue_auto_effect(*chain, "channels", &signal, &(*out)->signal, &status);
+    if (status == SOX_SUCCESS && signal.rate != (*out)->signal.rate)
+      cue_auto_effect(*chain, "rate", &signal, &(*out)->signal, &status);
+    if (status == SOX_SUCCESS && !no_dither && signal.precision >
+        (*out)->signal.precision && (*out)->signal.precision < 24)
+      cue_auto_effect(*chain, "dither", &signal, &(*out)->signal, &status);
+
+    effp = sox_create_effect(sox_find_effect("output"));
+    args[0] = (char *)*out;
+    if (status == SOX_SUCCESS && (sox_effect_options(effp, 1, args) != SOX_SUCCESS ||
+          sox_add_effect(*chain, effp, &signal, &(*out)->signal) != SOX_SUCCESS))
+      status = SOX_EOF;
+    free(effp);
+
+  }
+
+  for (i = 0; i < neffects; ++i) {
+    if (efftab[i] && i >= added) {  /* Not handed over to the chain */
+      efftab[i]->handler.kill(efftab[i]);
+      free(efftab[i]->priv);
+    }
+    free(efftab[i]);
+  }
+  free(efftab);
+  return status;
+}
+
+/* Closes the clip's output, deleting it if the clip failed; as cue_setup,
+ * called by one thread at a time. */
+static int cue_finish(cue_t const * cue, sox_format_t * out,
+    sox_effects_chain_t * chain, int status)
+{
+  if (chain)
+    sox_delete_effects_chain(chain);
+  if (out) {
+    if (out->clips)
+      lsx_warn("`%s' output clipped %" PRIu64 " samples; decrease volume?",
+          out->filename, out->clips);
+    if (status != SOX_SUCCESS && out->io_type == lsx_io_file) {
+      struct stat st;
+      if (!stat(out->filename, &st) && (st.st_mode & S_IFMT) == S_IFREG)
+        unlink(out->filename);
+    }
+    if (sox_close(out) != SOX_SUCCESS)
+      status = SOX_EOF;
+  }
+  if (status == SOX_SUCCESS)
+    lsx_report("`%s' done", cue->filename);
+  else lsx_fail("`%s' failed", cue->filename);
+  return status;
+}
+
+/* Cuts one clip; only the effects' flow is run in parallel with others. */
+static int cue_clip(cue_t const * cue, sox_format_t * * in, sox_bool * can_seek)
+{
+  sox_format_t * out = NULL;
+  sox_effects_chain_t * chain = NULL;
+  int status;
+
+#ifdef HAVE_OPENMP
+  #pragma omp critical(cue_setup)
+#endif
+  status = cue_setup(cue, in, can_seek, &out, &chain);
+
+  if (status == SOX_SUCCESS) {
+    sox_flow_effects(chain, NULL, NULL);
+    if (out->sox_errno || (*in)->sox_errno)
+      status = SOX_EOF;
+  }
+
+#ifdef HAVE_OPENMP
+  #pragma omp critical(cue_setup)
+#endif
+  status = cue_finish(cue, out, chain, status);
+  return status;
+}
+
+static int cue_list(int argc, char * * argv)
+{
+  long i, n;
+  int errors = 0;
+
+  if (split_on_silence && cue_list_name)
+    usage("--split and --cue-list can't be used together");
+  if (metrics.name)
+    usage("--metrics can't be used with --cue-list or --split");
+  if (file_count != 2 || !files[0]->filename[0] ||
+      !ofile->filename[0] != !split_on_silence)
+    usage(split_on_silence? "--split takes one input file and one output file" :
+        "--cue-list takes one input file and no output file");
+  if (!strcmp(files[0]->filename, "-"))
+    usage("The input for --cue-list or --split must be a file that can be read more than once");
+  if (files[0]->encoding.compression != HUGE_VAL || files[0]->oob.comments)
+    usage("A compression factor or comments can be given only for the clips");
+  input_count = 1;
+
+  add_eff_chain();
+  parse_effects(argc, argv);
+  if (effects_filename)
+    read_user_effects(effects_filename);
+  if (eff_chain_count)
+    usage("Only one effects chain can be given with --cue-list or --split");
+  if (split_on_silence)
+    find_split_segments();
+  else read_cue_list(cue_list_name);
+
+  /* Each sox_flow_effects runs one clip; the threads are for the clips. */
+  sox_globals.use_threads = sox_false;
+  seed_prng();
+  cue_seed = sox_globals.ranqd1;
+  n = (long)cue_count;
+#ifdef HAVE_OPENMP
+  #pragma omp parallel if(cue_threads && !no_clobber && n > 1) reduction(+:errors)
+#endif
+  {
+    sox_format_t * in = NULL;  /* This thread's reader */
+    sox_bool in_can_seek = sox_false;
+#ifdef HAVE_OPENMP
+    #pragma omp for schedule(dynamic)
+#endif
+    for (i = 0; i < n; ++i)
+      errors += cue_clip(&cues[i], &in, &in_can_seek) != SOX_SUCCESS;
+#ifdef HAVE_OPENMP
+    #pragma omp critical(cue_setup)
+#endif
+    if (in)
+      sox_close(in);
+  }
+
+  for (i = 0; i < n; ++i) {
+    free(cues[i].argv);
+    free(cues[i].line);
+  }
+  free(cues);
+  delete_eff_chains();
+  if (errors)
+    lsx_fail("%i of %li clips failed", errors, n);
+  success = 1;
+  return errors? 2 : 0;
+}
+
 static void output_message(unsigned level, const char *filename, const char *fmt, va_list ap)
 {
   char const * const str[] = {"FAIL", "WARN", "INFO", "DBUG"};
-  if (sox_globals.verbosity >= level) {
-    char base_name[128];
-    sox_basename(base_name, sizeof(base_name), filename);
+  char base_name[128];
+
+  sox_basename(base_name, sizeof(base_name), filename);
+  if (soxi_fail && level == 1 && !*soxi_fail) { /* For soxi -j's error field */
+    vsnprintf(soxi_fail, SOXI_FAIL_LEN, fmt, ap);
+    if (sox_globals.verbosity >= level)
+      fprintf(stderr, "%s %s %s: %s\n", myname, str[0], base_name, soxi_fail);
+  }
+  else if (sox_globals.verbosity >= level) {
     fprintf(stderr, "%s %s %s: ", myname, str[min(level - 1, 3)], base_name);
     vfprintf(stderr, fmt, ap);
     fprintf(stderr, "\n");
@@ -2866,6 +4110,9 @@ int main(int argc, char **argv)
   if (sox_globals.verbosity > 2)
     display_SoX_version(stderr);
 
+  if (cue_list_name || split_on_silence)
+    exit(cue_list(argc, argv));
+
   input_count = file_count ? file_count - 1 : 0;
 
   if (file_count) {
@@ -2964,11 +4211,7 @@ int main(int argc, char **argv)
     exit(0);
   }
 
-  if (!sox_globals.repeatable) {/* Re-seed PRNG? */
-    struct timeval now;
-    gettimeofday(&now, NULL);
-    sox_globals.ranqd1 = (int32_t)(now.tv_sec - now.tv_usec);
-  }
+  seed_prng();
 
   /* Save things that sox_sequence needs to be reinitialised for each segued
    * block of input files.*/
@@ -2984,6 +4227,7 @@ int main(int argc, char **argv)
     read_user_effects(effects_filename);
   }
 
+  open_metrics();
   for (;;) {
     err = process();
 
@@ -2999,6 +4243,7 @@ int main(int argc, char **argv)
       ofile->ft = NULL;
     }
   }
+  close_metrics();
 
   sox_delete_effects_chain(effects_chain);
   delete_eff_chains();
@@ -1051,6 +1051,7 @@ if clipping occurs.
 #define SOX_FILE_MONO    0x0100 /**< Client API: Do channel restrictions allow mono? */
 #define SOX_FILE_STEREO  0x0200 /**< Client API: Do channel restrictions allow stereo? */
 #define SOX_FILE_QUAD    0x0400 /**< Client API: Do channel restrictions allow quad? */
+#define SOX_FILE_RAW_DATA 0x0800 /**< Client API: Are 8-bit samples stored as by lsx_rawread/lsx_rawwrite, so that sox_transcode can copy them? */
 
 #define SOX_FILE_CHANS   (SOX_FILE_MONO | SOX_FILE_STEREO | SOX_FILE_QUAD) /**< Client API: No channel restrictions */
 #define SOX_FILE_LIT_END (SOX_FILE_ENDIAN | 0)                             /**< Client API: File is little-endian */
@@ -1083,6 +1084,7 @@ typedef struct sox_format_t sox_format_t;
 typedef struct sox_effect_t sox_effect_t;
 typedef struct sox_effect_handler_t sox_effect_handler_t;
 typedef struct sox_format_handler_t sox_format_handler_t;
+typedef struct lsx_capture_t lsx_capture_t;
 
 /*****************************************************************************
 Function pointers:
@@ -1340,6 +1342,25 @@ typedef struct sox_globals_t {
   Plugins should use similarly-sized DFTs to get best performance.
   */
   size_t       log2_dft_min_size;
+
+  /**
+  Requested audio device buffer and period sizes (in frames); 0 lets the
+  device driver choose.  Drivers that cannot honour them ignore them.
+  */
+  size_t       device_buffer;
+  size_t       device_period; /**< See device_buffer */
+
+  /**
+  If non-zero, audio capture devices are read on a separate thread into a
+  buffer of this many frames, from which sox_read then takes its samples.
+  */
+  size_t       capture_buffer;
+
+  /**
+  If true, format handlers that would otherwise have to scan a file to find
+  its exact length instead estimate it from the headers and first few frames.
+  */
+  sox_bool     quick_length;
 } sox_globals_t;
 
 /**
@@ -1493,6 +1514,24 @@ typedef struct sox_oob_t{
   /* TBD: Non-decoded chunks, etc: */
 } sox_oob_t;
 
+/**
+Client API:
+Real-time statistics kept by audio device drivers; all zero for files and
+for drivers that do not keep them.  Sizes are in frames.
+*/
+typedef struct sox_device_stats_t {
+  sox_uint64_t xruns;         /**< Overruns (recording) or underruns (playback) */
+  double       xrun_time;     /**< Total seconds spent recovering from xruns */
+  sox_uint64_t buffer_size;   /**< Device buffer size */
+  sox_uint64_t fill;          /**< Frames in the device buffer after the last transfer */
+  sox_uint64_t fill_min;      /**< Least fill seen since the device started */
+  sox_uint64_t fill_max;      /**< Most fill seen since the device started */
+  sox_uint64_t ring_size;     /**< Capture thread buffer size; 0 if not in use */
+  sox_uint64_t ring_fill;     /**< Frames in the capture thread buffer after the last read */
+  sox_uint64_t ring_fill_max; /**< Most fill seen in the capture thread buffer */
+  sox_uint64_t dropped;       /**< Frames lost because the capture thread buffer was full */
+} sox_device_stats_t;
+
 /**
 Client API:
 Data passed to/from the format handler
@@ -1536,6 +1575,8 @@ struct sox_format_t {
   sox_uint64_t     data_start;      /**< Offset at which headers end and sound data begins (set by lsx_check_read_params) */
   sox_format_handler_t handler;     /**< Format handler for this file */
   void             * priv;          /**< Format handler's private data area */
+  sox_device_stats_t device;        /**< Statistics kept by audio device drivers */
+  lsx_capture_t    * capture;       /**< Private: capture thread state, if any */
 };
 
 /**
@@ -1595,6 +1636,7 @@ struct sox_effect_t {
   size_t                   obeg;      /**< output buffer: start of valid data section */
   size_t                   oend;      /**< output buffer: one past valid data section (oend-obeg is length of current content) */
   size_t               imin;          /**< minimum input buffer content required for calling this effect's flow function; set via lsx_effect_set_imin() */
+  sox_uint64_t         olength;       /**< Samples (of all channels) output so far; may be read by the client */
 };
 
 /**
@@ -1953,6 +1995,37 @@ sox_write(
     size_t len /**< Number of samples available in buf. */
     );
 
+/**
+Client API:
+Returns true if samples can be copied from a decoding session to an
+encoding session with sox_transcode, i.e. without conversion to and from
+sox_sample_t.  Currently this is so for 8-bit linear, u-law and A-law
+samples stored as raw bytes, with the same rate and channels.
+@returns sox_true if sox_transcode may be used.
+*/
+sox_bool
+LSX_API
+sox_can_transcode(
+    LSX_PARAM_IN sox_format_t const * ift, /**< Decoding session. */
+    LSX_PARAM_IN sox_format_t const * oft  /**< Encoding session. */
+    );
+
+/**
+Client API:
+Copies samples from a decoding session to an encoding session, translating
+each code through a 256-entry table (e.g. u-law to A-law); the result is
+the same as that of sox_read followed by sox_write. Use only if
+sox_can_transcode returns true.
+@returns Number of samples copied, or 0 for EOF.
+*/
+size_t
+LSX_API
+sox_transcode(
+    LSX_PARAM_INOUT sox_format_t * ift, /**< Decoding session. */
+    LSX_PARAM_INOUT sox_format_t * oft, /**< Encoding session. */
+    size_t len /**< Maximum number of samples to copy. */
+    );
+
 /**
 Client API:
 Closes an encoding or decoding session.
@@ -2207,6 +2280,38 @@ sox_trim_clear_start(
     LSX_PARAM_INOUT sox_effect_t * effp /**< Trim effect. */
     );
 
+/**
+Client API:
+Gets the parts of the input that a silence effect has kept so far, as
+pairs of start and end positions in wide samples; a part still being kept
+is included once the effect has been drained.  The array is valid until
+the effect is stopped.
+@returns the number of parts (pairs) in the array.
+*/
+size_t
+LSX_API
+sox_silence_get_segments(
+    LSX_PARAM_IN sox_effect_t const * effp, /**< Silence effect. */
+    LSX_PARAM_OUT sox_uint64_t const * * segments /**< Receives the start, end pairs. */
+    );
+
+/**
+Client API:
+Changes the conversion ratio (input rate divided by output rate) of a
+running rate effect that was given the -V option, moving linearly to the
+new ratio over the given number of output samples.  The ratio may differ
+from the initial one by at most 5%.
+@returns SOX_SUCCESS if successful, or SOX_EOF if the effect is not a
+variable-ratio rate effect or the ratio is out of range.
+*/
+int
+LSX_API
+sox_rate_set_ratio(
+    LSX_PARAM_INOUT sox_effect_t * effp, /**< Rate effect, as in the effects chain. */
+    double factor, /**< New ratio. */
+    size_t glide /**< Output samples (per channel) over which to change the ratio. */
+    );
+
 /**
 Client API:
 Returns true if the specified file is a known playlist file type.
@@ -229,6 +229,11 @@ int lsx_check_read_params(sox_format_t * ft, unsigned channels,
 #define LSX_FORMAT_HANDLER(name) \
 sox_format_handler_t const * lsx_##name##_format_fn(void); \
 sox_format_handler_t const * lsx_##name##_format_fn(void)
+/* Capture thread */
+int lsx_capture_start(sox_format_t * ft);
+size_t lsx_capture_read(sox_format_t * ft, sox_sample_t * buf, size_t len);
+void lsx_capture_stop(sox_format_t * ft);
+
 #define div_bits(size, bits) ((uint64_t)(size) * 8 / bits)
 
 /* Raw I/O */
@@ -238,6 +243,8 @@ int lsx_rawstopread(sox_format_t * ft);
 int lsx_rawstartwrite(sox_format_t * ft);
 size_t lsx_rawwrite(sox_format_t * ft, const sox_sample_t *buf, size_t nsamp);
 int lsx_rawseek(sox_format_t * ft, uint64_t offset);
+sox_bool lsx_rawcantranscode(sox_format_t const * ift, sox_format_t const * oft);
+size_t lsx_rawtranscode(sox_format_t * ift, sox_format_t * oft, size_t nsamp);
 int lsx_rawstart(sox_format_t * ft, sox_bool default_rate, sox_bool default_channels, sox_bool default_length, sox_encoding_t encoding, unsigned bits_per_sample);
 #define lsx_rawstartread(ft) lsx_rawstart(ft, sox_false, sox_false, sox_false, SOX_ENCODING_UNKNOWN, 0)
 #define lsx_rawstartwrite lsx_rawstartread
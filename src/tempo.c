@@ -319,6 +319,145 @@ sox_effect_handler_t const * lsx_tempo_effect_fn(void)
 
 /*---------------------------------- pitch -----------------------------------*/
 
+/* Rather than leaving the change of rate to an automatically added `rate'
+ * effect, pitch resamples tempo's float output directly.  As in rate's
+ * arbitrary-ratio stage, the position in the input is kept by a clock with
+ * a 32-bit fraction, and each output is made by a poly-phase FIR whose
+ * coefficients are interpolated linearly between the two nearest of
+ * PHASES phases; so the shift is exact however small it is.  The input is
+ * held a channel to a fifo, so that the FIRs run over contiguous samples.
+ *
+ * The FIR (100 dB rejection, 87% band-width) is cheaper than, and not as
+ * good as, that of rate's default quality; matching rate's, it is slower
+ * than tempo + rate at any shift.  It is used only for shifts of up to
+ * MAX_INTERP_CENTS, where it was measured to be the faster (by 4-15%);
+ * for larger shifts, and an octave down in particular, where rate's
+ * half-band stages are hard to beat, rate is added as before. */
+#define MAX_INTERP_CENTS 700
+#define PHASE_BITS 8
+#define PHASES (1 << PHASE_BITS)
+#define FRAC_BITS 32
+
+typedef struct {
+  size_t channels;
+  fifo_t * input;        /* One per channel */
+  uint64_t step;         /* Input samples per output, with FRAC_BITS fraction */
+  uint32_t frac;         /* Fractional position of the next output */
+  size_t at;             /* Input fifo position of the next output */
+  int taps;              /* Per phase; a multiple of 4 */
+  float * coefs;         /* (PHASES + 1) x taps */
+  uint64_t samples_in;   /* Wide samples in, to the effect */
+  uint64_t samples_out;  /* Wide samples out, from the effect */
+} interp_t;
+
+static interp_t * interp_create(double step, size_t channels)
+{
+  interp_t * r = lsx_calloc(1, sizeof(*r));
+  double Fs = min(1, 1 / step), * h;
+  int i, j, n = 0;
+  size_t delay;
+
+  r->step = (uint64_t)(step * ((uint64_t)1 << FRAC_BITS) + .5);
+  lsx_design_lpf(.87 * Fs, Fs, -1., 100., &n, PHASES, -1.); /* Dummy run */
+  r->taps = ((n + 1) / PHASES + 3) & ~3;
+  n = r->taps * PHASES - 1;
+  h = lsx_design_lpf(.87 * Fs, Fs, 1., 100., &n, PHASES, -1.);
+  /* Phase PHASES is phase 0 a sample on, so that each pair is to hand: */
+  r->coefs = lsx_malloc((PHASES + 1) * r->taps * sizeof(*r->coefs));
+  for (i = 0; i <= PHASES; ++i) for (j = 0; j < r->taps; ++j) {
+    int k = PHASES * (r->taps - 1 - j) + i - 1;
+    r->coefs[i * r->taps + j] = k >= 0 && k < n? h[k] : 0;
+  }
+  free(h);
+  lsx_debug("pitch interpolation: step=%.9f taps=%i", step, r->taps);
+
+  /* Prime with zeros so that the first output is centred on the first input: */
+  delay = r->taps / 2 - 1;
+  r->channels = channels;
+  r->input = lsx_malloc(channels * sizeof(*r->input));
+  for (i = 0; i < (int)channels; ++i) {
+    fifo_create(&r->input[i], sizeof(float));
+    memset(fifo_reserve(&r->input[i], delay), 0, delay * sizeof(float));
+  }
+  return r;
+}
+
+static void interp_delete(interp_t * r)
+{
+  size_t i;
+  for (i = 0; i < r->channels; ++i)
+    fifo_delete(&r->input[i]);
+  free(r->input);
+  free(r->coefs);
+  free(r);
+}
+
+/* Takes all of tempo's output, separating the channels. */
+static void interp_input(interp_t * r, fifo_t * tempo_out)
+{
+  size_t n = fifo_occupancy(tempo_out), i, ch;
+  float const * s = fifo_read_ptr(tempo_out);
+
+  for (ch = 0; ch < r->channels; ++ch) {
+    float * d = fifo_reserve(&r->input[ch], n);
+    for (i = 0; i < n; ++i)
+      d[i] = s[i * r->channels + ch];
+  }
+  fifo_read(tempo_out, n, NULL);
+}
+
+/* Input samples needed before n more outputs can be made. */
+static size_t interp_needed(interp_t * r, size_t n)
+{
+  uint64_t steps = (uint64_t)(n - 1) * r->step + r->frac;
+  return n? r->at + (size_t)(steps >> FRAC_BITS) + r->taps : 0;
+}
+
+static size_t interp_output(interp_t * r, sox_sample_t * obuf, size_t n,
+    sox_uint64_t * clips)
+{
+  size_t avail = fifo_occupancy(&r->input[0]), i = 0, ch, at = r->at;
+  uint32_t frac = r->frac;
+  SOX_SAMPLE_LOCALS;
+
+  for (ch = 0; ch < r->channels; ++ch) {
+    float const * x = fifo_read_ptr(&r->input[ch]);
+    for (at = r->at, frac = r->frac, i = 0; i < n && at + r->taps <= avail; ++i) {
+      unsigned phase = frac >> (FRAC_BITS - PHASE_BITS);
+      float t = (float)(frac & ((1u << (FRAC_BITS - PHASE_BITS)) - 1)) *
+        (1.f / (1u << (FRAC_BITS - PHASE_BITS)));
+      float const * c = r->coefs + phase * r->taps, * d = c + r->taps;
+      float const * s = x + at;
+      float sum[4] = {0, 0, 0, 0}, sum1[4] = {0, 0, 0, 0}; /* Independent sums */
+      uint64_t next = frac + r->step;
+      int j, k;
+      for (j = 0; j < r->taps; j += 4) for (k = 0; k < 4; ++k) {
+        sum[k] += c[j + k] * s[j + k];
+        sum1[k] += d[j + k] * s[j + k];
+      }
+      sum[0] += sum[1] + sum[2] + sum[3];
+      sum1[0] += sum1[1] + sum1[2] + sum1[3];
+      obuf[i * r->channels + ch] =
+        SOX_FLOAT_32BIT_TO_SAMPLE(sum[0] + t * (sum1[0] - sum[0]), *clips);
+      at += (size_t)(next >> FRAC_BITS);
+      frac = (uint32_t)next;
+    }
+  }
+  r->samples_out += i;
+  r->frac = frac;
+  r->at = at - min(at, avail);
+  for (ch = 0; ch < r->channels; ++ch)
+    fifo_read(&r->input[ch], min(at, avail), NULL);
+  return i;
+}
+
+typedef struct {
+  priv_t      tempo;    /* Must be first */
+  interp_t    * interp; /* NULL if rate is to be added instead */
+  double      factor;   /* The shift; tempo's factor is rounded by %g */
+  sox_bool    use_interp;
+} pitch_priv_t;
+
 static int pitch_getopts(sox_effect_t * effp, int argc, char **argv)
 {
   double d;
@@ -328,7 +467,9 @@ static int pitch_getopts(sox_effect_t * effp, int argc, char **argv)
   if (argc <= pos || sscanf(argv[pos], "%lf %c", &d, &dummy) != 1)
     return lsx_usage(effp);
 
+  ((pitch_priv_t *)effp->priv)->use_interp = fabs(d) <= MAX_INTERP_CENTS;
   d = pow(2., d / 1200);  /* cents --> factor */
+  ((pitch_priv_t *)effp->priv)->factor = d;
   sprintf(arg, "%g", 1 / d);
   memcpy(argv2, argv, argc * sizeof(*argv2));
   argv2[pos] = arg;
@@ -339,13 +480,78 @@ static int pitch_getopts(sox_effect_t * effp, int argc, char **argv)
 
 static int pitch_start(sox_effect_t * effp)
 {
-  priv_t * p = (priv_t *) effp->priv;
+  pitch_priv_t * p = (pitch_priv_t *) effp->priv;
   int result = start(effp);
 
-  effp->out_signal.rate = effp->in_signal.rate / p->factor;
+  p->interp = NULL;
+  if (result == SOX_SUCCESS && p->use_interp) {
+    p->interp = interp_create(p->factor,
+        (size_t)effp->in_signal.channels);
+    effp->out_signal.length = effp->in_signal.length;
+  }
+  else effp->out_signal.rate = effp->in_signal.rate / p->tempo.factor;
   return result;
 }
 
+static int pitch_flow(sox_effect_t * effp, const sox_sample_t * ibuf,
+                sox_sample_t * obuf, size_t * isamp, size_t * osamp)
+{
+  pitch_priv_t * p = (pitch_priv_t *)effp->priv;
+  tempo_t * t = p->tempo.tempo;
+  size_t i, channels = effp->in_signal.channels, odone;
+  SOX_SAMPLE_LOCALS;
+
+  if (!p->interp)
+    return flow(effp, ibuf, obuf, isamp, osamp);
+  odone = interp_output(p->interp, obuf, *osamp / channels, &effp->clips);
+  if (*isamp && odone < *osamp / channels) {
+    float * s = tempo_input(t, NULL, *isamp / channels);
+    for (i = *isamp; i; --i)
+      *s++ = SOX_SAMPLE_TO_FLOAT_32BIT(*ibuf++, effp->clips);
+    p->interp->samples_in += *isamp / channels;
+    tempo_process(t);
+    interp_input(p->interp, &t->output_fifo);
+  }
+  else *isamp = 0;
+
+  *osamp = odone * channels;
+  return SOX_SUCCESS;
+}
+
+/* Outputs as many wide samples as were input, pushing silence through
+ * tempo until the interpolator has the input that those need. */
+static int pitch_drain(sox_effect_t * effp, sox_sample_t * obuf, size_t * osamp)
+{
+  pitch_priv_t * p = (pitch_priv_t *)effp->priv;
+  interp_t * r = p->interp;
+  tempo_t * t = p->tempo.tempo;
+  size_t channels = effp->in_signal.channels, n;
+  float * buff = NULL;
+
+  if (!r)
+    return drain(effp, obuf, osamp);
+  n = min(*osamp / channels, r->samples_in - r->samples_out);
+
+  while (fifo_occupancy(&r->input[0]) < interp_needed(r, n)) {
+    if (!buff)
+      buff = lsx_calloc(128 * channels, sizeof(*buff));
+    tempo_input(t, buff, (size_t) 128);
+    tempo_process(t);
+    interp_input(r, &t->output_fifo);
+  }
+  free(buff);
+  *osamp = interp_output(r, obuf, n, &effp->clips) * channels;
+  return SOX_SUCCESS;
+}
+
+static int pitch_stop(sox_effect_t * effp)
+{
+  pitch_priv_t * p = (pitch_priv_t *)effp->priv;
+  if (p->interp)
+    interp_delete(p->interp);
+  return stop(effp);
+}
+
 sox_effect_handler_t const * lsx_pitch_effect_fn(void)
 {
   static sox_effect_handler_t handler;
@@ -354,7 +560,11 @@ sox_effect_handler_t const * lsx_pitch_effect_fn(void)
   handler.usage = "[-q] shift-in-cents [segment-ms [search-ms [overlap-ms]]]",
   handler.getopts = pitch_getopts;
   handler.start = pitch_start;
+  handler.flow = pitch_flow;
+  handler.drain = pitch_drain;
+  handler.stop = pitch_stop;
   handler.flags &= ~SOX_EFF_LENGTH;
   handler.flags |= SOX_EFF_RATE;
+  handler.priv_size = sizeof(pitch_priv_t);
   return &handler;
 }
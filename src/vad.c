@@ -16,10 +16,15 @@
  */
 
 #include "sox_i.h"
+#include "fft4g.h"
 #include <string.h>
 
+/* Each channel's recent input is kept, as float, in a linear buffer of its
+ * own, so that a measurement's window is contiguous; the interleaved ring,
+ * p->samples, is kept only for output once speech has been found. */
 typedef struct {
-  double    * dftBuf, * noiseSpectrum, * spectrum, * measures, meanMeas;
+  float     * history, * dftBuf, * noiseSpectrum, * spectrum;
+  double    * measures, meanMeas, meas;
 } chan_t;
 
 typedef struct {                /* Configuration parameters: */
@@ -27,16 +32,22 @@ typedef struct {                /* Configuration parameters: */
   double    measureFreq, measureDuration, measureTc, preTriggerTime;
   double    hpFilterFreq, lpFilterFreq, hpLifterFreq, lpLifterFreq;
   double    triggerTc, triggerLevel, searchTime, gapTime;
+  sox_bool  analyse;            /* Report where speech starts; no audio */
                                 /* Working variables: */
   sox_sample_t  * samples;
   unsigned  dftLen_ws, samplesLen_ns, samplesIndex_ns, flushedLen_ns, gapLen;
   unsigned  measurePeriod_ns, measuresLen, measuresIndex;
   unsigned  measureTimer_ns, measureLen_ws, measureLen_ns;
+  unsigned  historyLen_ws, historyIndex_ws;
+  sox_uint64_t consumed_ns;
+  sox_bool  reported;
   unsigned  spectrumStart, spectrumEnd, cepstrumStart, cepstrumEnd; /* bins */
   int       bootCountMax, bootCount;
   double    noiseTcUpMult, noiseTcDownMult;
   double    measureTcMult, triggerMeasTcMult;
-  double    * spectrumWindow, * cepstrumWindow;
+  float     * spectrumWindow, * cepstrumWindow;
+  int       * dftBr;            /* Float FFT tables, shared by the channels */
+  float     * dftSc;
   chan_t    * channels;
 } priv_t;
 
@@ -48,7 +59,7 @@ typedef struct {                /* Configuration parameters: */
 static int create(sox_effect_t * effp, int argc, char * * argv)
 {
   priv_t * p = (priv_t *)effp->priv;
-  #define opt_str "+b:N:n:r:f:m:M:h:l:H:L:T:t:s:g:p:"
+  #define opt_str "+b:N:n:r:f:m:M:h:l:H:L:T:t:s:g:p:j"
   int c;
   lsx_getopt_t optstate;
   lsx_getopt_init(argc, argv, opt_str, NULL, lsx_getopt_flag_none, 1, &optstate);
@@ -91,9 +102,20 @@ static int create(sox_effect_t * effp, int argc, char * * argv)
     GETOPT_NUMERIC(optstate, 's', searchTime    ,  .1 , 4)
     GETOPT_NUMERIC(optstate, 'g', gapTime       ,  .1 , 1)
     GETOPT_NUMERIC(optstate, 'p', preTriggerTime,   0 , 4)
+    case 'j': p->analyse = sox_true; break;
     default: lsx_fail("invalid option `-%c'", optstate.opt); return lsx_usage(effp);
   }
-  return optstate.ind !=argc? lsx_usage(effp) : SOX_SUCCESS;
+  if (optstate.ind != argc)
+    return lsx_usage(effp);
+  if (p->analyse) {
+    if (effp->global_info->global_info->stdout_in_use_by) {
+      lsx_fail("stdout already in use by `%s'",
+          effp->global_info->global_info->stdout_in_use_by);
+      return SOX_EOF;
+    }
+    effp->global_info->global_info->stdout_in_use_by = effp->handler.name;
+  }
+  return SOX_SUCCESS;
 }
 
 static int start(sox_effect_t * effp)
@@ -117,21 +139,28 @@ static int start(sox_effect_t * effp)
 
   p->samplesLen_ns =
     fixedPreTriggerLen_ns + searchPreTriggerLen_ns + p->measureLen_ns;
-  lsx_Calloc(p->samples, p->samplesLen_ns);
+  if (!p->analyse)
+    lsx_Calloc(p->samples, p->samplesLen_ns);
 
+  p->historyLen_ws = p->measureLen_ws + p->measurePeriod_ns / effp->in_signal.channels;
   lsx_Calloc(p->channels, effp->in_signal.channels);
   for (i = 0; i < effp->in_signal.channels; ++i) {
     chan_t * c = &p->channels[i];
+    lsx_Calloc(c->history, p->historyLen_ws);
     lsx_Calloc(c->dftBuf, p->dftLen_ws);
     lsx_Calloc(c->spectrum, p->dftLen_ws);
     lsx_Calloc(c->noiseSpectrum, p->dftLen_ws);
     lsx_Calloc(c->measures, p->measuresLen);
   }
+  /* Make the FFT tables now, so that the channels only read them: */
+  lsx_Calloc(p->dftBr, dft_br_len(p->dftLen_ws));
+  lsx_Calloc(p->dftSc, dft_sc_len(p->dftLen_ws));
+  lsx_rdft_f((int)p->dftLen_ws, 1, p->channels[0].dftBuf, p->dftBr, p->dftSc);
 
   lsx_Calloc(p->spectrumWindow, p->measureLen_ws);
   for (i = 0; i < p->measureLen_ws; ++i)
     p->spectrumWindow[i] = -2./ SOX_SAMPLE_MIN / sqrt((double)p->measureLen_ws);
-  lsx_apply_hann(p->spectrumWindow, (int)p->measureLen_ws);
+  lsx_apply_hann_f(p->spectrumWindow, (int)p->measureLen_ws);
 
   p->spectrumStart = p->hpFilterFreq / effp->in_signal.rate * p->dftLen_ws + .5;
   p->spectrumStart = max(p->spectrumStart, 1);
@@ -141,7 +170,7 @@ static int start(sox_effect_t * effp)
   lsx_Calloc(p->cepstrumWindow, p->spectrumEnd - p->spectrumStart);
   for (i = 0; i < p->spectrumEnd - p->spectrumStart; ++i)
     p->cepstrumWindow[i] = 2 / sqrt((double)p->spectrumEnd - p->spectrumStart);
-  lsx_apply_hann(p->cepstrumWindow,(int)(p->spectrumEnd - p->spectrumStart));
+  lsx_apply_hann_f(p->cepstrumWindow,(int)(p->spectrumEnd - p->spectrumStart));
 
   p->cepstrumStart = ceil(effp->in_signal.rate * .5 / p->lpLifterFreq);
   p->cepstrumEnd  = floor(effp->in_signal.rate * .5 / p->hpLifterFreq);
@@ -157,6 +186,9 @@ static int start(sox_effect_t * effp)
   p->bootCountMax = p->bootTime * p->measureFreq - .5;
   p->measureTimer_ns = p->measureLen_ns;
   p->bootCount = p->measuresIndex = p->flushedLen_ns = p->samplesIndex_ns = 0;
+  p->historyIndex_ws = 0;
+  p->consumed_ns = 0;
+  p->reported = sox_false;
 
   effp->out_signal.length = SOX_UNKNOWN_LEN; /* depends on input data */
   return SOX_SUCCESS;
@@ -184,16 +216,16 @@ static int flowFlush(sox_effect_t * effp, sox_sample_t const * ibuf,
   return SOX_SUCCESS;
 }
 
-static double measure(
-    priv_t * p, chan_t * c, size_t index_ns, unsigned step_ns, int bootCount)
+static double measure(priv_t * p, chan_t * c, int bootCount)
 {
+  float const * x = c->history + p->historyIndex_ws - p->measureLen_ws;
   double mult, result = 0;
   size_t i;
 
-  for (i = 0; i < p->measureLen_ws; ++i, index_ns = (index_ns + step_ns) % p->samplesLen_ns)
-    c->dftBuf[i] = p->samples[index_ns] * p->spectrumWindow[i];
+  for (i = 0; i < p->measureLen_ws; ++i)
+    c->dftBuf[i] = x[i] * p->spectrumWindow[i];
   memset(c->dftBuf + i, 0, (p->dftLen_ws - i) * sizeof(*c->dftBuf));
-  lsx_safe_rdft((int)p->dftLen_ws, 1, c->dftBuf);
+  lsx_rdft_f((int)p->dftLen_ws, 1, c->dftBuf, p->dftBr, p->dftSc);
 
   memset(c->dftBuf, 0, p->spectrumStart * sizeof(*c->dftBuf));
   for (i = p->spectrumStart; i < p->spectrumEnd; ++i) {
@@ -208,7 +240,7 @@ static double measure(
     c->dftBuf[i] = d * p->cepstrumWindow[i - p->spectrumStart];
   }
   memset(c->dftBuf + i, 0, ((p->dftLen_ws >> 1) - i) * sizeof(*c->dftBuf));
-  lsx_safe_rdft((int)p->dftLen_ws >> 1, 1, c->dftBuf);
+  lsx_rdft_f((int)p->dftLen_ws >> 1, 1, c->dftBuf, p->dftBr, p->dftSc);
 
   for (i = p->cepstrumStart; i < p->cepstrumEnd; ++i)
     result += sqr(c->dftBuf[2 * i]) + sqr(c->dftBuf[2 * i + 1]);
@@ -216,53 +248,112 @@ static double measure(
   return max(0, 21 + result);
 }
 
+/* Appends len_ns interleaved samples to the channels' histories, keeping at
+ * least the last measurement's worth of each. */
+static void add_history(sox_effect_t * effp, sox_sample_t const * ibuf, size_t len_ns)
+{
+  priv_t * p = (priv_t *)effp->priv;
+  unsigned channels = effp->in_signal.channels, i;
+  size_t len_ws = len_ns / channels, j;
+
+  if (p->historyIndex_ws + len_ws > p->historyLen_ws) {
+    unsigned keep = min(p->historyIndex_ws, p->measureLen_ws);
+    for (i = 0; i < channels; ++i) {
+      chan_t * c = &p->channels[i];
+      memmove(c->history, c->history + p->historyIndex_ws - keep, keep * sizeof(*c->history));
+    }
+    p->historyIndex_ws = keep;
+  }
+  for (i = 0; i < channels; ++i) {
+    float * h = p->channels[i].history + p->historyIndex_ws;
+    sox_sample_t const * in = ibuf + i;
+    for (j = 0; j < len_ws; ++j, in += channels)
+      h[j] = *in;
+  }
+  p->historyIndex_ws += len_ws;
+}
+
+static void report(sox_effect_t * effp, sox_bool found)
+{
+  priv_t * p = (priv_t *)effp->priv;
+  sox_uint64_t pending = p->samplesLen_ns - p->flushedLen_ns, start_ws;
+
+  if (p->reported)
+    return;
+  p->reported = sox_true;
+  if (!found) {
+    printf("{\"speech_start\":null}\n");
+    fflush(stdout);
+    return;
+  }
+  start_ws = (p->consumed_ns - min(pending, p->consumed_ns)) / effp->in_signal.channels;
+  printf("{\"speech_start\":%.6f,\"sample\":%" PRIu64 "}\n",
+      start_ws / effp->in_signal.rate, start_ws);
+  fflush(stdout);
+}
+
 static int flowTrigger(sox_effect_t * effp, sox_sample_t const * ibuf,
     sox_sample_t * obuf, size_t * ilen, size_t * olen)
 {
   priv_t * p = (priv_t *)effp->priv;
   sox_bool hasTriggered = sox_false;
-  size_t i, idone = 0, numMeasuresToFlush = 0;
+  size_t len, idone = 0, numMeasuresToFlush = 0;
+  int channels = (int)effp->in_signal.channels, ch;
 
   while (idone < *ilen && !hasTriggered) {
-    p->measureTimer_ns -= effp->in_signal.channels;
-    for (i = 0; i < effp->in_signal.channels; ++i, ++idone) {
-      chan_t * c = &p->channels[i];
-      p->samples[p->samplesIndex_ns++] = *ibuf++;
-      if (!p->measureTimer_ns) {
-        size_t x = (p->samplesIndex_ns + p->samplesLen_ns - p->measureLen_ns) % p->samplesLen_ns;
-        double meas = measure(p, c, x, effp->in_signal.channels, p->bootCount);
-        c->measures[p->measuresIndex] = meas;
-        c->meanMeas = c->meanMeas * p->triggerMeasTcMult +
-            meas *(1 - p->triggerMeasTcMult);
-
-        if (hasTriggered |= c->meanMeas >= p->triggerLevel) {
-          unsigned n = p->measuresLen, k = p->measuresIndex;
-          unsigned j, jTrigger = n, jZero = n;
-          for (j = 0; j < n; ++j, k = (k + n - 1) % n)
-            if (c->measures[k] >= p->triggerLevel && j <= jTrigger + p->gapLen)
-              jZero = jTrigger = j;
-            else if (!c->measures[k] && jTrigger >= jZero)
-              jZero = j;
-          j = min(j, jZero);
-          numMeasuresToFlush = range_limit(j, numMeasuresToFlush, n);
-        }
-        lsx_debug_more("%12g %12g %u",
-            meas, c->meanMeas, (unsigned)numMeasuresToFlush);
-      }
+    len = min(*ilen - idone, p->measureTimer_ns);
+    if (p->samples) {
+      len = min(len, p->samplesLen_ns - p->samplesIndex_ns);
+      memcpy(p->samples + p->samplesIndex_ns, ibuf, len * sizeof(*ibuf));
+      if ((p->samplesIndex_ns += len) == p->samplesLen_ns)
+        p->samplesIndex_ns = 0;
     }
-    if (p->samplesIndex_ns == p->samplesLen_ns)
-      p->samplesIndex_ns = 0;
-    if (!p->measureTimer_ns) {
-      p->measureTimer_ns = p->measurePeriod_ns;
-      ++p->measuresIndex;
-      p->measuresIndex %= p->measuresLen;
-      if (p->bootCount >= 0)
-        p->bootCount = p->bootCount == p->bootCountMax? -1 : p->bootCount + 1;
+    add_history(effp, ibuf, len);
+    ibuf += len, idone += len, p->consumed_ns += len;
+    if ((p->measureTimer_ns -= len))
+      continue;
+
+#ifdef HAVE_OPENMP
+    #pragma omp parallel for if(sox_globals.use_threads && channels > 1) schedule(static)
+#endif
+    for (ch = 0; ch < channels; ++ch)
+      p->channels[ch].meas = measure(p, &p->channels[ch], p->bootCount);
+
+    for (ch = 0; ch < channels; ++ch) {
+      chan_t * c = &p->channels[ch];
+      double meas = c->meas;
+      c->measures[p->measuresIndex] = meas;
+      c->meanMeas = c->meanMeas * p->triggerMeasTcMult +
+          meas *(1 - p->triggerMeasTcMult);
+
+      if (hasTriggered |= c->meanMeas >= p->triggerLevel) {
+        unsigned n = p->measuresLen, k = p->measuresIndex;
+        unsigned j, jTrigger = n, jZero = n;
+        for (j = 0; j < n; ++j, k = (k + n - 1) % n)
+          if (c->measures[k] >= p->triggerLevel && j <= jTrigger + p->gapLen)
+            jZero = jTrigger = j;
+          else if (!c->measures[k] && jTrigger >= jZero)
+            jZero = j;
+        j = min(j, jZero);
+        numMeasuresToFlush = range_limit(j, numMeasuresToFlush, n);
+      }
+      lsx_debug_more("%12g %12g %u",
+          meas, c->meanMeas, (unsigned)numMeasuresToFlush);
     }
+    p->measureTimer_ns = p->measurePeriod_ns;
+    ++p->measuresIndex;
+    p->measuresIndex %= p->measuresLen;
+    if (p->bootCount >= 0)
+      p->bootCount = p->bootCount == p->bootCountMax? -1 : p->bootCount + 1;
   }
   if (hasTriggered) {
     size_t ilen1 = *ilen - idone;
     p->flushedLen_ns = (p->measuresLen - numMeasuresToFlush) * p->measurePeriod_ns;
+    if (p->analyse) {
+      report(effp, sox_true);
+      *ilen = idone, *olen = 0;
+      return SOX_EOF;
+    }
     p->samplesIndex_ns = (p->samplesIndex_ns + p->flushedLen_ns) % p->samplesLen_ns;
     (effp->handler.flow = flowFlush)(effp, ibuf, obuf, &ilen1, olen);
     idone += ilen1;
@@ -274,7 +365,14 @@ static int flowTrigger(sox_effect_t * effp, sox_sample_t const * ibuf,
 
 static int drain(sox_effect_t * effp, sox_sample_t * obuf, size_t * olen)
 {
+  priv_t * p = (priv_t *)effp->priv;
   size_t ilen = 0;
+
+  if (p->analyse) {
+    report(effp, sox_false);
+    *olen = 0;
+    return SOX_EOF;
+  }
   return effp->handler.flow(effp, NULL, obuf, &ilen, olen);
 }
 
@@ -289,8 +387,11 @@ static int stop(sox_effect_t * effp)
     free(c->noiseSpectrum);
     free(c->spectrum);
     free(c->dftBuf);
+    free(c->history);
   }
   free(p->channels);
+  free(p->dftSc);
+  free(p->dftBr);
   free(p->cepstrumWindow);
   free(p->spectrumWindow);
   free(p->samples);
@@ -310,6 +411,7 @@ sox_effect_handler_t const * lsx_vad_effect_fn(void)
     "\t-s search-time                  (1 s)",
     "\t-g allowed-gap                  (0.25 s)",
     "\t-p pre-trigger-time             (0 s)",
+    "\t-j report where speech starts, as JSON; don't trim",
     "Advanced options:",
     "\t-b noise-est-boot-time          (0.35 s)",
     "\t-N noise-est-time-constant-up   (0.1 s)",
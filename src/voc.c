@@ -200,6 +200,8 @@ typedef struct {
 /* Prototypes for internal functions */
 static int getblock(sox_format_t *);
 static void blockstart(sox_format_t *);
+static sox_bool length_known(sox_format_t *);
+static void writelength(sox_format_t *, uint64_t);
 
 /* Conversion macros (from raw.c) */
 #define SOX_ALAW_BYTE_TO_SAMPLE(d) ((sox_sample_t)(sox_alaw2linear16(d)) << 16)
@@ -455,7 +457,9 @@ static int startwrite(sox_format_t * ft)
 {
   priv_t * v = (priv_t *) ft->priv;
 
-  if (!ft->seekable) {
+  /* The data block length can be written up front if the length is
+   * known; otherwise it must be patched in afterwards. */
+  if (!ft->seekable && !length_known(ft)) {
     lsx_fail_errno(ft, SOX_EOF,
                    "Output .voc file must be a file, not a pipe");
     return (SOX_EOF);
@@ -510,9 +514,15 @@ static size_t write_samples(sox_format_t * ft, const sox_sample_t * buf,
 static void blockstop(sox_format_t * ft)
 {
   priv_t * v = (priv_t *) ft->priv;
-  sox_sample_t datum;
 
   lsx_writeb(ft, 0);    /* End of file block code */
+  if (!v->silent && length_known(ft) &&
+      (uint64_t)v->samples == ft->signal.length)
+    return;     /* Length written by blockstart() was right */
+  if (!ft->seekable) {
+    lsx_warn("Length in output .voc header will be wrong since can't seek to fix it");
+    return;
+  }
   lsx_seeki(ft, (off_t) v->blockseek, 0); /* seek back to block length */
   lsx_seeki(ft, (off_t)1, 1);  /* seek forward one */
   if (v->silent) {
@@ -523,13 +533,7 @@ static void blockstop(sox_format_t * ft)
         lsx_seeki(ft, (off_t)8, 1);    /* forward 7 + 1 for new block header */
       }
     }
-    v->samples += 2;    /* adjustment: SBDK pp. 3-5 */
-    datum = (v->samples * (ft->encoding.bits_per_sample >> 3)) & 0xff;
-    lsx_writesb(ft, datum);     /* low byte of length */
-    datum = ((v->samples * (ft->encoding.bits_per_sample >> 3)) >> 8) & 0xff;
-    lsx_writesb(ft, datum);     /* middle byte of length */
-    datum = ((v->samples * (ft->encoding.bits_per_sample >> 3)) >> 16) & 0xff;
-    lsx_writesb(ft, datum);     /* high byte of length */
+    writelength(ft, (uint64_t)v->samples);
   }
 }
 
@@ -772,17 +776,13 @@ static void blockstart(sox_format_t * ft)
         lsx_writeb(ft, 1);      /* samples are in stereo */
       }
       lsx_writeb(ft, VOC_DATA); /* Voice Data block code */
-      lsx_writeb(ft, 0);        /* block length (for now) */
-      lsx_writeb(ft, 0);        /* block length (for now) */
-      lsx_writeb(ft, 0);        /* block length (for now) */
+      writelength(ft, length_known(ft)? ft->signal.length : 0);
       v->rate = 256 - (1000000.0 / ft->signal.rate) + .5;
       lsx_writesb(ft, (signed) v->rate); /* Rate code */
       lsx_writeb(ft, 0);        /* 8-bit raw data */
     } else {
       lsx_writeb(ft, VOC_DATA_16);      /* Voice Data block code */
-      lsx_writeb(ft, 0);        /* block length (for now) */
-      lsx_writeb(ft, 0);        /* block length (for now) */
-      lsx_writeb(ft, 0);        /* block length (for now) */
+      writelength(ft, length_known(ft)? ft->signal.length : 0);
       v->rate = ft->signal.rate + .5;
       lsx_writedw(ft, (unsigned) v->rate);      /* Rate code */
       lsx_writeb(ft, 16);       /* Sample Size */
@@ -796,6 +796,34 @@ static void blockstart(sox_format_t * ft)
   }
 }
 
+/*-----------------------------------------------------------------
+ * length_known() -- whether the output length is known in advance,
+ *                   and so can go in the data block header as it
+ *                   is written, with no need to seek back later
+ *-----------------------------------------------------------------*/
+static sox_bool length_known(sox_format_t * ft)
+{
+  uint64_t bytes = (ft->signal.length + 2) * (ft->encoding.bits_per_sample >> 3);
+
+  return ft->signal.length && ft->signal.length < SOX_IGNORE_LENGTH &&
+    bytes < (1 << 24);
+}
+
+/*-----------------------------------------------------------------
+ * writelength() -- write the 24-bit length of a data block holding
+ *                  the given number of samples (0 for a placeholder)
+ *-----------------------------------------------------------------*/
+static void writelength(sox_format_t * ft, uint64_t samples)
+{
+  uint64_t bytes = 0;
+
+  if (samples)
+    bytes = (samples + 2) * (ft->encoding.bits_per_sample >> 3); /* adjustment: SBDK pp. 3-5 */
+  lsx_writeb(ft, bytes & 0xff);         /* low byte of length */
+  lsx_writeb(ft, (bytes >> 8) & 0xff);  /* middle byte of length */
+  lsx_writeb(ft, (bytes >> 16) & 0xff); /* high byte of length */
+}
+
 LSX_FORMAT_HANDLER(voc)
 {
   static char const *const names[] = { "voc", NULL };
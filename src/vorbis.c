@@ -29,10 +29,6 @@
 
 #define DEF_BUF_LEN 4096
 
-#define BUF_ERROR -1
-#define BUF_EOF  0
-#define BUF_DATA 1
-
 #define HEADER_ERROR 0
 #define HEADER_OK   1
 
@@ -50,10 +46,9 @@ typedef struct {
 typedef struct {
   /* Decoding data */
   OggVorbis_File *vf;
-  char *buf;
-  size_t buf_len;
+  float **pcm;    /* Decoder's planar output; owned by libvorbisfile */
   size_t start;
-  size_t end;     /* Unsent data samples in buf[start] through buf[end-1] */
+  size_t end;     /* Unsent frames in pcm[][start] through pcm[][end-1] */
   int current_section;
   int eof;
 
@@ -144,10 +139,7 @@ static int startread(sox_format_t * ft)
   for (i = 0; i < vc->comments; i++)
     sox_append_comment(&ft->oob.comments, vc->user_comments[i]);
 
-  /* Setup buffer */
-  vb->buf_len = DEF_BUF_LEN;
-  vb->buf_len -= vb->buf_len % (vi->channels*2); /* 2 bytes per sample */
-  vb->buf = lsx_calloc(vb->buf_len, sizeof(char));
+  vb->pcm = NULL;
   vb->start = vb->end = 0;
 
   /* Fill in other info */
@@ -158,29 +150,24 @@ static int startread(sox_format_t * ft)
 }
 
 
-/* Refill the buffer with samples.  Returns BUF_EOF if the end of the
- * vorbis data was reached while the buffer was being filled,
- * BUF_ERROR is something bad happens, and BUF_DATA otherwise */
-static int refill_buffer(priv_t * vb)
+/* Fetch the next block of decoded frames.  They are taken in float
+ * straight from the decoder, so no precision is lost on the way to the
+ * sample buffer.  Returns the number of frames available, or 0 at the
+ * end of the stream or on error. */
+static size_t refill_buffer(priv_t * vb, size_t wanted)
 {
-  int num_read;
-
-  if (vb->start == vb->end)     /* Samples all played */
-    vb->start = vb->end = 0;
+  long num_read;
 
-  while (vb->end < vb->buf_len) {
-    num_read = ov_read(vb->vf, vb->buf + vb->end,
-        (int) (vb->buf_len - vb->end), 0, 2, 1, &vb->current_section);
-    if (num_read == 0)
-      return (BUF_EOF);
-    else if (num_read == OV_HOLE)
+  do {
+    num_read = ov_read_float(vb->vf, &vb->pcm,
+        (int) min(wanted, DEF_BUF_LEN), &vb->current_section);
+    if (num_read == OV_HOLE)
       lsx_warn("Warning: hole in stream; probably harmless");
-    else if (num_read < 0)
-      return (BUF_ERROR);
-    else
-      vb->end += num_read;
-  }
-  return (BUF_DATA);
+  } while (num_read == OV_HOLE);
+
+  vb->start = 0;
+  vb->end = num_read > 0 ? (size_t) num_read : 0;
+  return vb->end;
 }
 
 
@@ -194,29 +181,31 @@ static int refill_buffer(priv_t * vb)
 static size_t read_samples(sox_format_t * ft, sox_sample_t * buf, size_t len)
 {
   priv_t * vb = (priv_t *) ft->priv;
-  size_t i;
-  int ret;
-  sox_sample_t l;
-
+  unsigned channels = ft->signal.channels, c;
+  size_t frames = len / channels, done = 0, n, j;
+  SOX_SAMPLE_LOCALS;
 
-  for (i = 0; i < len; i++) {
+  while (done < frames) {
     if (vb->start == vb->end) {
       if (vb->eof)
         break;
-      ret = refill_buffer(vb);
-      if (ret == BUF_EOF || ret == BUF_ERROR) {
+      if (!refill_buffer(vb, frames - done)) {
         vb->eof = 1;
-        if (vb->end == 0)
-          break;
+        break;
       }
     }
 
-    l = (vb->buf[vb->start + 1] << 24)
-        | (0xffffff & (vb->buf[vb->start] << 16));
-    *(buf + i) = l;
-    vb->start += 2;
+    n = min(frames - done, vb->end - vb->start);
+    for (c = 0; c < channels; ++c) {
+      float const * src = vb->pcm[c] + vb->start;
+      sox_sample_t * dst = buf + done * channels + c;
+      for (j = 0; j < n; ++j, dst += channels)
+        *dst = SOX_FLOAT_32BIT_TO_SAMPLE(src[j], ft->clips);
+    }
+    vb->start += n;
+    done += n;
   }
-  return i;
+  return done * channels;
 }
 
 /*
@@ -227,7 +216,6 @@ static int stopread(sox_format_t * ft)
 {
   priv_t * vb = (priv_t *) ft->priv;
 
-  free(vb->buf);
   ov_clear(vb->vf);
 
   return (SOX_SUCCESS);
@@ -412,7 +400,13 @@ static int seek(sox_format_t * ft, uint64_t offset)
 {
   priv_t * vb = (priv_t *) ft->priv;
 
-  return ov_pcm_seek(vb->vf, (ogg_int64_t)(offset / ft->signal.channels))? SOX_EOF:SOX_SUCCESS;
+  if (ov_pcm_seek(vb->vf, (ogg_int64_t)(offset / ft->signal.channels)))
+    return SOX_EOF;
+  /* The frames in pcm were the decoder's block from before the seek */
+  vb->pcm = NULL;
+  vb->start = vb->end = 0;
+  vb->eof = 0;
+  return SOX_SUCCESS;
 }
 
 LSX_FORMAT_HANDLER(vorbis)
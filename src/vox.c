@@ -36,6 +36,11 @@ int lsx_vox_stopread(sox_format_t * ft)
   return lsx_adpcm_stopread(ft, (adpcm_io_t *)ft->priv);
 }
 
+int lsx_vox_seek(sox_format_t * ft, uint64_t offset)
+{
+  return lsx_adpcm_seek(ft, (adpcm_io_t *)ft->priv, offset);
+}
+
 size_t lsx_vox_write(sox_format_t * ft, const sox_sample_t *buffer, size_t length)
 {
   return lsx_adpcm_write(ft, (adpcm_io_t *)ft->priv, buffer, length);
@@ -81,6 +81,13 @@
 /* To allow padding to samplesPerBlock. Works, but currently never true. */
 static const size_t pad_nsamps = sox_false;
 
+/* ADPCM blocks carry their own header state, so they are read and written
+ * in batches of this many blocks which can be coded in parallel. */
+#define ADPCM_BATCH_BLOCKS 32
+
+/* ADPCM encoder search effort, selected with -C; also IMA's search width */
+#define ADPCM_MAX_EFFORT 9
+
 /* Private data for .wav file */
 typedef struct {
     /* samples/channel reading: starts at total count and decremented  */
@@ -100,13 +107,15 @@ typedef struct {
     /* following used by *ADPCM wav files */
     unsigned short nCoefs;          /* ADPCM: number of coef sets */
     short         *lsx_ms_adpcm_i_coefs;          /* ADPCM: coef sets           */
-    void          *ms_adpcm_data;   /* Private data of adpcm decoder */
-    unsigned char *packet;          /* Temporary buffer for packets */
-    short         *samples;         /* interleaved samples buffer */
+    void         **ms_adpcm_data;   /* Private data of adpcm decoder, per block */
+    unsigned char *packet;          /* Temporary buffer for a batch of packets */
+    short         *samples;         /* interleaved samples buffer for a batch */
     short         *samplePtr;       /* Pointer to current sample  */
     short         *sampleTop;       /* End of samples-buffer      */
-    unsigned short blockSamplesRemaining;/* Samples remaining per channel */
+    size_t         blockSamplesRemaining;/* Samples remaining per channel */
     int            state[16];       /* step-size info for *ADPCM writes */
+    int           *blockState;      /* per-block step-size info for a batch */
+    int            effort;          /* ADPCM encoder search effort */
 
 #ifdef HAVE_LIBGSM
     /* following used by GSM 6.10 wav */
@@ -159,49 +168,13 @@ static int wav_ima_adpcm_fmt(sox_format_t *ft, uint32_t len)
         return SOX_EOF;
     }
 
-    wav->packet = lsx_malloc(wav->blockAlign);
-    wav->samples =
-        lsx_malloc(ft->signal.channels * wav->samplesPerBlock * sizeof(short));
+    wav->packet = lsx_malloc(ADPCM_BATCH_BLOCKS * wav->blockAlign);
+    wav->samples = lsx_malloc(ADPCM_BATCH_BLOCKS *
+        ft->signal.channels * wav->samplesPerBlock * sizeof(short));
 
     return SOX_SUCCESS;
 }
 
-/*
- *
- * ImaAdpcmReadBlock - Grab and decode complete block of samples
- *
- */
-static unsigned short  ImaAdpcmReadBlock(sox_format_t * ft)
-{
-    priv_t *       wav = (priv_t *) ft->priv;
-    size_t bytesRead;
-    int samplesThisBlock;
-
-    /* Pull in the packet and check the header */
-    bytesRead = lsx_readbuf(ft, wav->packet, (size_t)wav->blockAlign);
-    samplesThisBlock = wav->samplesPerBlock;
-    if (bytesRead < wav->blockAlign)
-    {
-        /* If it looks like a valid header is around then try and */
-        /* work with partial blocks.  Specs say it should be null */
-        /* padded but I guess this is better than trailing quiet. */
-        samplesThisBlock = lsx_ima_samples_in((size_t)0, (size_t)ft->signal.channels, bytesRead, (size_t) 0);
-        if (samplesThisBlock == 0 || samplesThisBlock > wav->samplesPerBlock)
-        {
-            lsx_warn("Premature EOF on .wav input file");
-            return 0;
-        }
-    }
-
-    wav->samplePtr = wav->samples;
-
-    /* For a full block, the following should be true: */
-    /* wav->samplesPerBlock = blockAlign - 8byte header + 1 sample in header */
-    lsx_ima_block_expand_i(ft->signal.channels, wav->packet, wav->samples, samplesThisBlock);
-    return samplesThisBlock;
-
-}
-
 /****************************************************************************/
 /* MS ADPCM Support Functions Section                                       */
 /****************************************************************************/
@@ -246,13 +219,15 @@ static int wav_ms_adpcm_fmt(sox_format_t *ft, uint32_t len)
         return SOX_EOF;
     }
 
-    wav->packet = lsx_malloc(wav->blockAlign);
-    wav->samples =
-        lsx_malloc(ft->signal.channels * wav->samplesPerBlock * sizeof(short));
+    wav->packet = lsx_malloc(ADPCM_BATCH_BLOCKS * wav->blockAlign);
+    wav->samples = lsx_malloc(ADPCM_BATCH_BLOCKS *
+        ft->signal.channels * wav->samplesPerBlock * sizeof(short));
 
     /* nCoefs, lsx_ms_adpcm_i_coefs used by adpcm.c */
     wav->lsx_ms_adpcm_i_coefs = lsx_malloc(wav->nCoefs * 2 * sizeof(short));
-    wav->ms_adpcm_data = lsx_ms_adpcm_alloc(ft->signal.channels);
+    wav->ms_adpcm_data = lsx_calloc(ADPCM_BATCH_BLOCKS, sizeof(void *));
+    for (i = 0; i < ADPCM_BATCH_BLOCKS; i++)
+        wav->ms_adpcm_data[i] = lsx_ms_adpcm_alloc(ft->signal.channels);
 
     err = lsx_read_fields(ft, &len, "*h",
                           2 * wav->nCoefs, wav->lsx_ms_adpcm_i_coefs);
@@ -268,74 +243,136 @@ static int wav_ms_adpcm_fmt(sox_format_t *ft, uint32_t len)
     return SOX_SUCCESS;
 }
 
+/****************************************************************************/
+/* Common ADPCM Read Function                                               */
+/****************************************************************************/
+
 /*
  *
- * AdpcmReadBlock - Grab and decode complete block of samples
+ * xxxAdpcmReadBatch - Grab and decode a batch of complete blocks
  *
  */
-static unsigned short  AdpcmReadBlock(sox_format_t * ft)
+static size_t xxxAdpcmReadBatch(sox_format_t * ft)
 {
     priv_t *       wav = (priv_t *) ft->priv;
-    size_t bytesRead;
-    int samplesThisBlock;
-    const char *errmsg;
-
-    /* Pull in the packet and check the header */
-    bytesRead = lsx_readbuf(ft, wav->packet, (size_t) wav->blockAlign);
-    samplesThisBlock = wav->samplesPerBlock;
-    if (bytesRead < wav->blockAlign)
+    unsigned chans = ft->signal.channels;
+    size_t blocks = ADPCM_BATCH_BLOCKS, bytesRead, fullBlocks, samplesLastBlock;
+    const char *errmsg[ADPCM_BATCH_BLOCKS];
+    int b;
+
+    /* Don't read beyond the data chunk when its size is known */
+    if (!wav->ignoreSize)
+        blocks = min(blocks, (wav->numSamples + wav->samplesPerBlock - 1) /
+                             wav->samplesPerBlock);
+
+    /* Pull in the packets */
+    bytesRead = lsx_readbuf(ft, wav->packet, blocks * wav->blockAlign);
+    fullBlocks = bytesRead / wav->blockAlign;
+    samplesLastBlock = 0;
+    if (bytesRead % wav->blockAlign)
     {
         /* If it looks like a valid header is around then try and */
         /* work with partial blocks.  Specs say it should be null */
         /* padded but I guess this is better than trailing quiet. */
-        samplesThisBlock = lsx_ms_adpcm_samples_in((size_t)0, (size_t)ft->signal.channels, bytesRead, (size_t)0);
-        if (samplesThisBlock == 0 || samplesThisBlock > wav->samplesPerBlock)
-        {
-            lsx_warn("Premature EOF on .wav input file");
-            return 0;
-        }
+        size_t bytesLastBlock = bytesRead % wav->blockAlign;
+        samplesLastBlock = wav->formatTag == WAVE_FORMAT_IMA_ADPCM?
+            lsx_ima_samples_in((size_t)0, (size_t)chans, bytesLastBlock, (size_t)0) :
+            lsx_ms_adpcm_samples_in((size_t)0, (size_t)chans, bytesLastBlock, (size_t)0);
+        if (samplesLastBlock > wav->samplesPerBlock)
+            samplesLastBlock = 0;
     }
+    if (!fullBlocks && !samplesLastBlock)
+    {
+        lsx_warn("Premature EOF on .wav input file");
+        return 0;
+    }
+    blocks = fullBlocks + (samplesLastBlock != 0);
 
-    errmsg = lsx_ms_adpcm_block_expand_i(wav->ms_adpcm_data, ft->signal.channels, wav->nCoefs, wav->lsx_ms_adpcm_i_coefs, wav->packet, wav->samples, samplesThisBlock);
+    /* Each block carries its own header state, so decode them in parallel */
+#ifdef HAVE_OPENMP
+    #pragma omp parallel for if(sox_globals.use_threads) schedule(static)
+#endif
+    for (b = 0; b < (int)blocks; b++) {
+        const unsigned char *packet = wav->packet + b * wav->blockAlign;
+        short *samples = wav->samples + b * wav->samplesPerBlock * chans;
+        int n = (size_t)b < fullBlocks? wav->samplesPerBlock : (int)samplesLastBlock;
+
+        /* For a full IMA block, the following should be true: */
+        /* wav->samplesPerBlock = blockAlign - 8byte header + 1 sample in header */
+        errmsg[b] = NULL;
+        if (wav->formatTag == WAVE_FORMAT_IMA_ADPCM)
+            lsx_ima_block_expand_i(chans, packet, samples, n);
+        else
+            errmsg[b] = lsx_ms_adpcm_block_expand_i(wav->ms_adpcm_data[b],
+                chans, wav->nCoefs, wav->lsx_ms_adpcm_i_coefs, packet, samples, n);
+    }
 
-    if (errmsg)
-        lsx_warn("%s", errmsg);
+    for (b = 0; b < (int)blocks; b++)
+        if (errmsg[b])
+            lsx_warn("%s", errmsg[b]);
 
-    return samplesThisBlock;
+    return fullBlocks * wav->samplesPerBlock + samplesLastBlock;
 }
 
 /****************************************************************************/
 /* Common ADPCM Write Function                                              */
 /****************************************************************************/
 
-static int xxxAdpcmWriteBlock(sox_format_t * ft)
+static int xxxAdpcmWriteBatch(sox_format_t * ft)
 {
     priv_t * wav = (priv_t *) ft->priv;
-    size_t chans, ct;
+    size_t chans, ct, blocks, blockSamples;
     short *p;
+    int b;
 
     chans = ft->signal.channels;
     p = wav->samplePtr;
     ct = p - wav->samples;
     if (ct>=chans) {
-        /* zero-fill samples if needed to complete block */
-        for (p = wav->samplePtr; p < wav->sampleTop; p++) *p=0;
+        blockSamples = chans * wav->samplesPerBlock;
+        blocks = (ct + blockSamples - 1) / blockSamples;
+
+        /* zero-fill samples if needed to complete the last block */
+        for (p = wav->samplePtr; p < wav->samples + blocks * blockSamples; p++) *p=0;
+
+        /* Blocks after the first start from an estimate of the state the
+         * previous block leaves, so that they can be mashed in parallel */
+        memcpy(wav->blockState, wav->state, chans * sizeof(int));
+        for (b = 1; b < (int)blocks; b++) {
+            short const *prev = wav->samples + (b - 1) * blockSamples;
+            if (wav->formatTag == WAVE_FORMAT_ADPCM)
+                lsx_ms_adpcm_block_prime_i((unsigned) chans, prev, wav->samplesPerBlock, wav->blockState + b * chans);
+            else
+                lsx_ima_block_prime_i((unsigned) chans, prev, wav->samplesPerBlock, wav->blockState + b * chans);
+        }
+
         /* compress the samples to wav->packet */
-        if (wav->formatTag == WAVE_FORMAT_ADPCM) {
-            lsx_ms_adpcm_block_mash_i((unsigned) chans, wav->samples, wav->samplesPerBlock, wav->state, wav->packet, wav->blockAlign);
-        }else{ /* WAVE_FORMAT_IMA_ADPCM */
-            lsx_ima_block_mash_i((unsigned) chans, wav->samples, wav->samplesPerBlock, wav->state, wav->packet, 9);
+#ifdef HAVE_OPENMP
+        #pragma omp parallel for if(sox_globals.use_threads) schedule(static)
+#endif
+        for (b = 0; b < (int)blocks; b++) {
+            short const *samples = wav->samples + b * blockSamples;
+            unsigned char *packet = wav->packet + b * wav->blockAlign;
+            int *state = wav->blockState + b * chans;
+
+            if (wav->formatTag == WAVE_FORMAT_ADPCM) {
+                lsx_ms_adpcm_block_mash_i((unsigned) chans, samples, wav->samplesPerBlock, state, packet, wav->blockAlign, wav->effort);
+            }else{ /* WAVE_FORMAT_IMA_ADPCM */
+                lsx_ima_block_mash_i((unsigned) chans, samples, wav->samplesPerBlock, state, packet, wav->effort);
+            }
         }
-        /* write the compressed packet */
-        if (lsx_writebuf(ft, wav->packet, (size_t) wav->blockAlign) != wav->blockAlign)
+        memcpy(wav->state, wav->blockState + (blocks - 1) * chans, chans * sizeof(int));
+
+        /* write the compressed packets */
+        if (lsx_writebuf(ft, wav->packet, blocks * wav->blockAlign) != blocks * wav->blockAlign)
         {
             lsx_fail_errno(ft,SOX_EOF,"write error");
             return (SOX_EOF);
         }
         /* update lengths and samplePtr */
-        wav->dataLength += wav->blockAlign;
+        wav->dataLength += blocks * wav->blockAlign;
         if (pad_nsamps)
-          wav->numSamples += wav->samplesPerBlock;
+          wav->numSamples += blocks * wav->samplesPerBlock;
         else
           wav->numSamples += ct/chans;
         wav->samplePtr = wav->samples;
@@ -1005,10 +1042,7 @@ static size_t read_samples(sox_format_t *ft, sox_sample_t *buf, size_t len)
 
             /* See if need to read more from disk */
             if (wav->blockSamplesRemaining == 0) {
-                if (wav->formatTag == WAVE_FORMAT_IMA_ADPCM)
-                    wav->blockSamplesRemaining = ImaAdpcmReadBlock(ft);
-                else
-                    wav->blockSamplesRemaining = AdpcmReadBlock(ft);
+                wav->blockSamplesRemaining = xxxAdpcmReadBatch(ft);
 
                 if (wav->blockSamplesRemaining == 0) {
                     /* Don't try to read any more samples */
@@ -1083,7 +1117,12 @@ static int stopread(sox_format_t * ft)
     free(wav->packet);
     free(wav->samples);
     free(wav->lsx_ms_adpcm_i_coefs);
-    free(wav->ms_adpcm_data);
+    if (wav->ms_adpcm_data) {
+        int i;
+        for (i = 0; i < ADPCM_BATCH_BLOCKS; i++)
+            free(wav->ms_adpcm_data[i]);
+        free(wav->ms_adpcm_data);
+    }
 
     switch (ft->encoding.encoding)
     {
@@ -1117,6 +1156,20 @@ static int startwrite(sox_format_t * ft)
             return rc;
     }
 
+    wav->effort = ADPCM_MAX_EFFORT;
+    if ((ft->encoding.encoding == SOX_ENCODING_MS_ADPCM ||
+         ft->encoding.encoding == SOX_ENCODING_IMA_ADPCM) &&
+        ft->encoding.compression != HUGE_VAL) {
+        double effort = ft->encoding.compression;
+        if (!(effort >= 0 && effort <= ADPCM_MAX_EFFORT) || effort != floor(effort)) {
+          lsx_fail_errno(ft, SOX_EINVAL,
+                 "ADPCM encoder effort must be a whole number from 0 to %i",
+                 ADPCM_MAX_EFFORT);
+          return SOX_EOF;
+        }
+        wav->effort = effort;
+    }
+
     wav->numSamples = 0;
     wav->dataLength = 0;
     if (!ft->signal.length && !ft->seekable)
@@ -1140,9 +1193,10 @@ static int startwrite(sox_format_t * ft)
             /* #channels already range-checked for overflow in wavwritehdr() */
             for (ch=0; ch<ft->signal.channels; ch++)
                 wav->state[ch] = 0;
-            sbsize = ft->signal.channels * wav->samplesPerBlock;
-            wav->packet = lsx_malloc((size_t)wav->blockAlign);
+            sbsize = ADPCM_BATCH_BLOCKS * ft->signal.channels * wav->samplesPerBlock;
+            wav->packet = lsx_malloc(ADPCM_BATCH_BLOCKS * (size_t)wav->blockAlign);
             wav->samples = lsx_malloc(sbsize*sizeof(short));
+            wav->blockState = lsx_calloc(ADPCM_BATCH_BLOCKS * ft->signal.channels, sizeof(int));
             wav->sampleTop = wav->samples + sbsize;
             wav->samplePtr = wav->samples;
             break;
@@ -1369,8 +1423,9 @@ static int wavwritehdr(sox_format_t * ft, int second_header)
     if (dwDataLength > UINT32_MAX)
         dwDataLength = UINT32_MAX;
 
+    /* Length unknown: mark the sizes as unknown, as for streamed wav */
     if (!second_header && !ft->signal.length)
-        dwDataLength = UINT32_MAX;
+        dwDataLength = wRiffLength = UINT32_MAX;
 
     if (wRiffLength > UINT32_MAX)
         wRiffLength = UINT32_MAX;
@@ -1510,7 +1565,7 @@ static size_t write_samples(sox_format_t * ft, const sox_sample_t *buf, size_t l
 
                 wav->samplePtr = p;
                 if (p == wav->sampleTop)
-                    xxxAdpcmWriteBlock(ft);
+                    xxxAdpcmWriteBatch(ft);
 
             }
             return total_len - len;
@@ -1524,10 +1579,8 @@ static size_t write_samples(sox_format_t * ft, const sox_sample_t *buf, size_t l
             break;
 #endif
 
-        default:
-            len = lsx_rawwrite(ft, buf, len);
-            wav->numSamples += (len/ft->signal.channels);
-            return len;
+        default: /* Counted by stopwrite; see SOX_FILE_RAW_DATA */
+            return lsx_rawwrite(ft, buf, len);
         }
 }
 
@@ -1543,13 +1596,16 @@ static int stopwrite(sox_format_t * ft)
         {
         case WAVE_FORMAT_IMA_ADPCM:
         case WAVE_FORMAT_ADPCM:
-            xxxAdpcmWriteBlock(ft);
+            xxxAdpcmWriteBatch(ft);
             break;
 #ifdef HAVE_LIBGSM
         case WAVE_FORMAT_GSM610:
             wavgsmstopwrite(ft);
             break;
 #endif
+        default: /* Includes any samples copied by sox_transcode */
+            wav->numSamples = ft->olength / ft->signal.channels;
+            break;
         }
 
         /* Add a pad byte if the number of data bytes is odd.
@@ -1560,15 +1616,23 @@ static int stopwrite(sox_format_t * ft)
         free(wav->packet);
         free(wav->samples);
         free(wav->lsx_ms_adpcm_i_coefs);
+        free(wav->blockState);
 
         /* All samples are already written out. */
         /* If file header needs fixing up, for example it needs the */
         /* the number of samples in a field, seek back and write them here. */
-        if (ft->signal.length && wav->numSamples <= 0xffffffff && 
-            wav->numSamples == ft->signal.length)
+        /* The header written by startwrite is already right if the length */
+        /* was known then, so the output can be a pipe or append-only. */
+        if (ft->signal.length && wav->numSamples <= 0xffffffff &&
+            wav->numSamples == ft->signal.length / ft->signal.channels)
           return SOX_SUCCESS;
-        if (!ft->seekable)
+        if (!ft->seekable) {
+          /* Sizes marked unknown are fine for a stream */
+          if (!ft->signal.length)
+            return SOX_SUCCESS;
+          lsx_warn("Length in output .wav header will be wrong since can't seek to fix it");
           return SOX_EOF;
+        }
 
         if (lsx_seeki(ft, (off_t)0, SEEK_SET) != 0)
         {
@@ -1611,7 +1675,10 @@ static int seek(sox_format_t * ft, uint64_t offset)
       alignment = offset % wav->samplesPerBlock;
       if (alignment != 0)
           new_offset += (wav->samplesPerBlock - alignment);
-      wav->numSamples = ft->signal.length - (new_offset / ft->signal.channels);
+      wav->numSamples = (ft->signal.length - new_offset) / ft->signal.channels;
+#ifdef HAVE_LIBGSM
+      wav->gsmindex = 0;  /* Drop what is left of the frame decoded before */
+#endif
     }
   } else {
     double wide_sample = offset - (offset % ft->signal.channels);
@@ -1619,7 +1686,7 @@ static int seek(sox_format_t * ft, uint64_t offset)
     off_t to = to_d;
     ft->sox_errno = (to != to_d)? SOX_EOF : lsx_seeki(ft, (off_t)wav->dataStart + (off_t)to, SEEK_SET);
     if (ft->sox_errno == SOX_SUCCESS)
-      wav->numSamples -= (size_t)wide_sample / ft->signal.channels;
+      wav->numSamples = (ft->signal.length - (uint64_t)wide_sample) / ft->signal.channels;
   }
 
   return ft->sox_errno;
@@ -1641,7 +1708,7 @@ LSX_FORMAT_HANDLER(wav)
     SOX_ENCODING_FLOAT, 32, 64, 0,
     0};
   static sox_format_handler_t const handler = {SOX_LIB_VERSION_CODE,
-    "Microsoft audio format", names, SOX_FILE_LIT_END,
+    "Microsoft audio format", names, SOX_FILE_LIT_END | SOX_FILE_RAW_DATA,
     startread, read_samples, stopread,
     startwrite, write_samples, stopwrite,
     seek, write_encodings, NULL, sizeof(priv_t)